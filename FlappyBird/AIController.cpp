@@ -4,15 +4,37 @@
 #include <vector>
 #include <fstream>
 #include <bitset>
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+
+#include "Profiler.hpp"
+#include "AllocationCounter.hpp"
+#include "ProcessStats.hpp"
+#include "Metrics.hpp"
+#include "GenerationStats.h"
+#include "ReplayLibrary.hpp"
+#include "BackgroundWriter.hpp"
 
 using namespace std;
 #define ERROR_DISTANCE 9999
 
+std::string AIController::s_filePrefix;
+unsigned int AIController::s_breedingSeed = 0;
+std::shared_ptr<const Generation> AIController::s_savedGeneration;
+int AIController::s_savedGenerationNum = -1;
+int AIController::s_historyGenerationNum = -1;
+int AIController::s_historyScoredNum = -1;
+bool AIController::s_statsAppendable = false;
+std::chrono::steady_clock::time_point AIController::s_evaluationStart;
+
 
 AIController::AIController()
 {
 	m_pGameState = nullptr;
 	m_bShouldFlap = false;
+	_racingStage = 0;
+	_stageStartTick = 0;
 
 #if EXPORT
 	std::ofstream o("export.csv");
@@ -23,18 +45,26 @@ AIController::AIController()
 		o << std::to_string(i) << ",";
 	o << std::endl;
 
+	GenomeHistory history;
+	history.Open(GetGenomeHistoryFilePath());
+
 	while (true)
 	{
-		std::ifstream f("generation_" + std::to_string(_currentGenerationNum) + ".json");
-		if (!f.good())
-			break;
+		// A pruned generation is only in the history
+		if (!GenerationFile::Load(GetGenerationFilePath(_currentGenerationNum), _currentGeneration))
+		{
+			std::shared_ptr<const Generation> rebuilt = history.Rebuild(_currentGenerationNum);
+			if (!rebuilt)
+				break;
+			_currentGeneration = *rebuilt;
+		}
+
 		o << _currentGenerationNum << ",";
-		_currentGeneration = json::parse(f);
-		for (int birdNum = 0; birdNum < BIRD_COUNT; birdNum++)
+		for (const Chromosome& chromosome : _currentGeneration.chromosomes)
 		{
-			if (!_currentGeneration[JSON_CHROMOSOME + std::to_string(birdNum)].contains(JSON_SCORE))
+			if (!chromosome.scored)
 				break;
-			o << _currentGeneration[JSON_CHROMOSOME + std::to_string(birdNum)][JSON_SCORE] << ",";
+			o << chromosome.score << ",";
 		}
 		o << std::endl;
 		_currentGenerationNum++;
@@ -45,114 +75,115 @@ AIController::AIController()
 #endif
 }
 
-void AIController::Init()
+bool AIController::Init()
 {
-	// JSON Loading
+	MEMORY_TAG(GA);
 
-#if REPLAY
-	std::ifstream f("generation_" + std::to_string(REPLAY_GENERATION) + ".json");
-	_currentGeneration = json::parse(f);
+	// Init runs every episode, only the first starts the clock rather than the splash screen and menu
+	if (s_evaluationStart == std::chrono::steady_clock::time_point())
+		s_evaluationStart = std::chrono::steady_clock::now();
 
-	_currentGenerationNum = REPLAY_GENERATION;
+	// JSON Loading
 
-	std::cout << "Replaying " + std::to_string(_currentGenerationNum) + "\n" << std::endl;
-#else
 	_currentGenerationNum = -1;
 	_currentChromosomeNum = -1;
 
+	// Every generation before the last one saved is finished, and that one may still be on its way to disk
+	if (s_savedGeneration)
+		_currentGenerationNum = s_savedGenerationNum - 1;
+	else
+		_currentGenerationNum = FindFirstGeneration() - 1;
+
 	while (_currentChromosomeNum < 0)
 	{
-		std::ifstream f("generation_" + std::to_string(_currentGenerationNum + 1) + ".json");
-		if (!f.good())
-			break;
+		if (s_savedGeneration && s_savedGenerationNum == _currentGenerationNum + 1)
+			_currentGeneration = *s_savedGeneration;
+		else
+		{
+			std::string filePath = GetGenerationFilePath(_currentGenerationNum + 1);
+			if (!std::ifstream(filePath).good())
+				break;
+			// Carrying on would breed over it, so a damaged generation stops training
+			if (!GenerationFile::Load(filePath, _currentGeneration))
+				return false;
+		}
 		_currentGenerationNum++;
-		_currentGeneration = json::parse(f);
 		for (int chromosome = 0; chromosome < BIRD_COUNT; chromosome++)
-			if (!_currentGeneration[JSON_CHROMOSOME + std::to_string(chromosome)].contains(JSON_SCORE))
+			if (!_currentGeneration.chromosomes[chromosome].scored)
 			{
 				_currentChromosomeNum = chromosome;
 				break;
 			}
 	}
 
+	if (_currentGeneration.hasStage)
+		_racingStage = _currentGeneration.stage;
+
 	// No Generation found, so create one
 	if (_currentGenerationNum < 0)
 	{
-		for (int chromosome = 0; chromosome < BIRD_COUNT; chromosome++)
+		for (Chromosome& chromosome : _currentGeneration.chromosomes)
 		{
-			// Create a Network
-			json networkJSON;
-
 			for (int layer = 0; layer < HIDDEN_LAYER_COUNT; layer++)
 			{
-				json layerJSON;
-
 				for (int neuron = 0; neuron < NEURONS_PER_HIDDEN_LAYER; neuron++)
 				{
-					json neuronJSON;
-
-					// Randomise Weights
-
-					int weightCount = NEURONS_PER_HIDDEN_LAYER;
+					float* genes = chromosome.genes + GenerationFile::GetNeuronOffset(layer, neuron);
 					// If this is the first hidden layer, the inputs are the input values
-					if (layer == 0)
-						weightCount = INPUT_COUNT;
+					int weightCount = GenerationFile::GetWeightCount(layer);
 
+					// Randomise Weights
 					for (int i = 0; i < weightCount; i++)
-						neuronJSON[JSON_WEIGHTS].push_back((static_cast <float> (rand()) / static_cast <float> (RAND_MAX / (RANDOM_WIEGHT_MAX * 2))) - RANDOM_WIEGHT_MAX);
+						genes[i] = (static_cast <float> (rand()) / static_cast <float> (RAND_MAX / (RANDOM_WIEGHT_MAX * 2))) - RANDOM_WIEGHT_MAX;
 
 					// Randomise Bias
-					neuronJSON[JSON_BIAS] = (static_cast <float> (rand()) / static_cast <float> (RAND_MAX / (RANDOM_BIAS_MAX * 2))) - RANDOM_BIAS_MAX;
-
-					// Add Neuron to Layer JSON
-					layerJSON[JSON_NEURON + std::to_string(neuron)] = neuronJSON;
+					genes[weightCount] = (static_cast <float> (rand()) / static_cast <float> (RAND_MAX / (RANDOM_BIAS_MAX * 2))) - RANDOM_BIAS_MAX;
 				}
-
-				// Add Layer to Network JSON
-				networkJSON[JSON_LAYER + std::to_string(layer)] = layerJSON;
 			}
 
 			// ----- Output Neuron
-			json outputJSON;
+			float* genes = chromosome.genes + GenerationFile::GetOutputOffset();
 
 			// Randomise Weights
 			for (int i = 0; i < NEURONS_PER_HIDDEN_LAYER; i++)
-				outputJSON[JSON_WEIGHTS].push_back((static_cast <float> (rand()) / static_cast <float> (RAND_MAX / (RANDOM_WIEGHT_MAX * 2))) - RANDOM_WIEGHT_MAX);
+				genes[i] = (static_cast <float> (rand()) / static_cast <float> (RAND_MAX / (RANDOM_WIEGHT_MAX * 2))) - RANDOM_WIEGHT_MAX;
 
 			// Randomise Bias
-			outputJSON[JSON_BIAS] = (static_cast <float> (rand()) / static_cast <float> (RAND_MAX / (RANDOM_BIAS_MAX * 2))) - RANDOM_BIAS_MAX;
-
-			// Add Output Neuron to Network JSON
-			networkJSON[JSON_OUTPUT] = outputJSON;
-
-			// ----- Add Network to Generation JSON
-			_currentGeneration[JSON_CHROMOSOME + std::to_string(chromosome)] = networkJSON;
+			genes[NEURONS_PER_HIDDEN_LAYER] = (static_cast <float> (rand()) / static_cast <float> (RAND_MAX / (RANDOM_BIAS_MAX * 2))) - RANDOM_BIAS_MAX;
 		}
 
 		_currentGenerationNum = 0;
 		_currentChromosomeNum = 0;
 
 		SaveCurrentGeneration();
+		RecordHistory(nullptr);
 	}
 	else if (_currentChromosomeNum < 0)
 	{
-		// Stopped after completing a generation but didn't create a new one
-		CreateNewGeneration();
+		// Stopped after completing a stage but didn't move on from it
+		EndEpisode();
 	}
 
-	std::cout << "Starting at " + std::to_string(_currentGenerationNum) + "\n" << std::endl;
-#endif
+	std::cout << "Starting at " + std::to_string(_currentGenerationNum) + " stage " + std::to_string(_racingStage) + "\n" << std::endl;
 
 	for (int chromosome = 0; chromosome < BIRD_COUNT; chromosome++)
-		_neuralNetworks.push_back(new NeuralNetwork(_currentGeneration[JSON_CHROMOSOME + std::to_string(chromosome)]));
+	{
+		_neuralNetworks.push_back(new NeuralNetwork(_currentGeneration.chromosomes[chromosome].genes));
+
+		// Only chromosomes that haven't been scored in this stage need to fly
+		if (_currentGeneration.chromosomes[chromosome].scored)
+			continue;
+		_activeChromosomes.push_back(chromosome);
+	}
+
+	METRIC_SET(Generation, _currentGenerationNum);
+	METRIC_SET(RacingStage, _racingStage);
+
+	return true;
 }
 
 AIController::~AIController()
 {
-#if !REPLAY
-	CreateNewGeneration();
-#endif
-
 	for (int i = 0; i < _neuralNetworks.size(); i++)
 		delete _neuralNetworks[i];
 }
@@ -172,10 +203,8 @@ void AIController::update(Bird* bird)
 	float fDistanceToFloor = distanceToFloor(land, bird);
 	float fDistanceToNearestPipe = distanceToNearestPipes(pipe, bird);
 
-	std::vector<float> inputs;
-	inputs.push_back(fDistanceToFloor);
-	inputs.push_back(fDistanceToNearestPipe);
-	inputs.push_back(444.0f);
+	// On the stack, this runs for every bird every tick
+	float inputs[INPUT_COUNT] = { fDistanceToFloor, fDistanceToNearestPipe, 444.0f };
 
 	if (fDistanceToNearestPipe != ERROR_DISTANCE) {
 		float fDistanceToCentreOfGap = distanceToCentreOfPipeGap(pipe, bird);
@@ -183,7 +212,7 @@ void AIController::update(Bird* bird)
 		inputs[2] = fDistanceToCentreOfGap;
 	}
 
-	m_bShouldFlap = _neuralNetworks[bird->GetID()]->Calculate(inputs, 0) > 0.0f;
+	m_bShouldFlap = _neuralNetworks[bird->GetID()]->Calculate(inputs) > 0.0f;
 
 	// this means the birdie always flaps. Should only be called when the bird should need to flap. 
 	//m_bShouldFlap = true;
@@ -194,7 +223,7 @@ void AIController::update(Bird* bird)
 float AIController::distanceToFloor(Land* land, Bird* bird)
 {
 	// the land is always the same height so get the first sprite
-	std::vector<sf::Sprite> landSprites = land->GetSprites();
+	const std::vector<sf::Sprite>& landSprites = land->GetSprites();
 	if (landSprites.size() > 0)
 	{
 		return landSprites.at(0).getPosition().y - bird->GetSprite().getPosition().y;
@@ -206,12 +235,12 @@ float AIController::distanceToFloor(Land* land, Bird* bird)
 float AIController::distanceToNearestPipes(Pipe* pipe, Bird* bird)
 {
 	float nearest1 = 999999;
-	sf::Sprite* nearestSprite1 = nullptr;
+	const sf::Sprite* nearestSprite1 = nullptr;
 
 	// get nearest pipes
-	std::vector<sf::Sprite> pipeSprites = pipe->GetSprites();
+	const std::vector<sf::Sprite>& pipeSprites = pipe->GetSprites();
 	for (unsigned int i = 0; i < pipeSprites.size(); i++) {
-		sf::Sprite s = pipeSprites.at(i);
+		const sf::Sprite& s = pipeSprites.at(i);
 		float fDistance = s.getPosition().x - bird->GetSprite().getPosition().x;
 		if (fDistance > 0 && fDistance < nearest1) {
 			nearestSprite1 = &(pipeSprites.at(i));
@@ -229,13 +258,13 @@ float AIController::distanceToCentreOfPipeGap(Pipe* pipe, Bird* bird)
 {
 	float nearest1 = 999999;
 	float nearest2 = 999999;
-	sf::Sprite* nearestSprite1 = nullptr;
-	sf::Sprite* nearestSprite2 = nullptr;
+	const sf::Sprite* nearestSprite1 = nullptr;
+	const sf::Sprite* nearestSprite2 = nullptr;
 
 	// get nearest pipes
-	std::vector<sf::Sprite> pipeSprites = pipe->GetSprites();
+	const std::vector<sf::Sprite>& pipeSprites = pipe->GetSprites();
 	for (unsigned int i = 0; i < pipeSprites.size(); i++) {
-		sf::Sprite s = pipeSprites.at(i);
+		const sf::Sprite& s = pipeSprites.at(i);
 		float fDistance = s.getPosition().x - bird->GetSprite().getPosition().x;
 		if (fDistance > 0 && fDistance < nearest1) {
 			nearestSprite1 = &(pipeSprites.at(i));
@@ -251,8 +280,8 @@ float AIController::distanceToCentreOfPipeGap(Pipe* pipe, Bird* bird)
 		return ERROR_DISTANCE;
 
 
-	sf::Sprite* topSprite = nullptr;
-	sf::Sprite* bottomSprite = nullptr;
+	const sf::Sprite* topSprite = nullptr;
+	const sf::Sprite* bottomSprite = nullptr;
 
 	if (nearestSprite1->getPosition().y < nearestSprite2->getPosition().y) {
 		topSprite = nearestSprite1;
@@ -281,25 +310,319 @@ bool AIController::shouldFlap()
 void AIController::BirdDied(Bird* bird, int score)
 {
 	Log(std::to_string(bird->GetID()) + " died at " + std::to_string(score) + "\n");
-	_currentGeneration[JSON_CHROMOSOME + std::to_string(bird->GetID())][JSON_SCORE] = score;
+	RecordEpisode(bird, score);
+}
+
+void AIController::BirdRetired(Bird* bird, int score)
+{
+	Log(std::to_string(bird->GetID()) + " retired at " + std::to_string(score) + "\n");
+	_retired.set(bird->GetID());
+	RecordEpisode(bird, score);
+}
+
+void AIController::RecordEpisode(Bird* bird, int score)
+{
+	MEMORY_TAG(GA);
+
+	Chromosome& chromosome = _currentGeneration.chromosomes[bird->GetID()];
+	unsigned int ticks = m_pGameState->GetTick();
+
+	METRIC_ADD(Episodes, 1);
+
+	chromosome.scored = true;
+	chromosome.score = score;
+	chromosome.flown = true;
+	chromosome.stage = _racingStage;
+	chromosome.ticks = ticks;
+
+	// Only what it flew this stage, any before that was counted by the stage it flew it in
+	_currentGeneration.ticksSimulated += ticks - std::min(ticks, _stageStartTick);
+}
+
+void AIController::SaveCheckpoint(Sonar::StateWriter& out)
+{
+	out.Write(_currentGenerationNum);
+	out.Write(_racingStage);
+	out.Write(_stageStartTick);
+
+	out.Write(_currentGeneration.ticksSimulated);
+
+	// Earlier stages' scores are in the file already, so a score here is one from this episode
+	out.Write((unsigned int)_activeChromosomes.size());
+	for (int id : _activeChromosomes)
+	{
+		const Chromosome& chromosome = _currentGeneration.chromosomes[id];
+
+		out.Write(id);
+		out.Write(chromosome.scored);
+		out.Write(chromosome.scored ? chromosome.score : 0);
+		out.Write(chromosome.scored ? chromosome.ticks : 0u);
+	}
+}
+
+bool AIController::LoadCheckpoint(Sonar::StateReader& in)
+{
+	MEMORY_TAG(GA);
+
+	struct Result
+	{
+		bool scored;
+		int score;
+		unsigned int ticks;
+	};
+
+	if (in.Read<int>() != _currentGenerationNum || in.Read<int>() != _racingStage)
+		return false;
+
+	unsigned int stageStartTick = in.Read<unsigned int>();
+	unsigned int ticksSimulated = in.Read<unsigned int>();
+
+	if (in.Read<unsigned int>() != _activeChromosomes.size())
+		return false;
+
+	// Read it all first, so a checkpoint for other birds leaves nothing half applied
+	std::vector<Result> results;
+	for (int id : _activeChromosomes)
+	{
+		if (in.Read<int>() != id)
+			return false;
+
+		Result result;
+		result.scored = in.Read<bool>();
+		result.score = in.Read<int>();
+		result.ticks = in.Read<unsigned int>();
+		results.push_back(result);
+	}
+
+	if (!in.IsValid())
+		return false;
+
+	for (unsigned int i = 0; i < results.size(); i++)
+	{
+		if (!results[i].scored)
+			continue;
+
+		Chromosome& chromosome = _currentGeneration.chromosomes[_activeChromosomes[i]];
+		chromosome.scored = true;
+		chromosome.score = results[i].score;
+		chromosome.flown = true;
+		chromosome.stage = _racingStage;
+		chromosome.ticks = results[i].ticks;
+	}
+
+	_currentGeneration.ticksSimulated = ticksSimulated;
+	_stageStartTick = stageStartTick;
+
+	return true;
+}
+
+unsigned int AIController::GetEpisodeTickLimit()
+{
+	static const unsigned int stageTicks[RACING_STAGE_COUNT] = RACING_STAGE_TICKS;
+	return stageTicks[_racingStage];
+}
+
+void AIController::EndEpisode()
+{
+	// Race the best of this stage on over a longer episode before breeding
+	if (_racingStage < RACING_STAGE_COUNT - 1)
+		PromoteToNextStage();
+	else
+		CreateNewGeneration();
+
+	_retired.reset();
+}
+
+void AIController::PromoteToNextStage()
+{
+	MEMORY_TAG(GA);
+
+	// Everyone who flew in this stage, best first
+	std::vector<int> runners;
+	for (int chromosome = 0; chromosome < BIRD_COUNT; chromosome++)
+		if (_currentGeneration.chromosomes[chromosome].stage == _racingStage)
+			runners.push_back(chromosome);
+
+	std::stable_sort(runners.begin(), runners.end(), [this](int a, int b)
+		{
+			return _currentGeneration.chromosomes[a].score > _currentGeneration.chromosomes[b].score;
+		});
+
+	int keep = (int)std::ceil(runners.size() * RACING_KEEP_FRACTION);
+	if (keep < 1)
+		keep = 1;
+
+	static const unsigned int stageTicks[RACING_STAGE_COUNT] = RACING_STAGE_TICKS;
+	unsigned int finalTicks = stageTicks[RACING_STAGE_COUNT - 1];
+	// Which were retired is only known by the controller that flew the stage, not one picking it up finished after a restart
+	bool flownHere = !_activeChromosomes.empty();
+
+	Log("Stage " + std::to_string(_racingStage) + " promotes " + std::to_string(keep) + " of " + std::to_string(runners.size()) + ": ");
+	for (int i = 0; i < (int)runners.size(); i++)
+	{
+		Chromosome& chromosome = _currentGeneration.chromosomes[runners[i]];
+		bool flying = flownHere ? _retired.test(runners[i]) : stageTicks[_racingStage] > 0 && chromosome.ticks >= stageTicks[_racingStage];
+
+		if (i < keep)
+		{
+			// Clearing the score is what puts a chromosome back in the running. The course and its network
+			// are the same every time, so one that died would only die the same way again
+			if (flying)
+				chromosome.scored = false;
+			else
+				chromosome.stage = _racingStage + 1;
+
+			Log(std::to_string(runners[i]));
+			if (i < keep - 1)
+				Log(", ");
+		}
+		else if (flying && finalTicks > chromosome.ticks)
+			_currentGeneration.ticksSaved += finalTicks - chromosome.ticks;
+	}
+	Log("\n");
+
+	_currentGeneration.hasTicksSaved = finalTicks > 0;
+	_racingStage++;
+	_currentGeneration.hasStage = true;
+	_currentGeneration.stage = _racingStage;
+
+	SaveCurrentGeneration();
+}
+
+void AIController::LogTicksSaved()
+{
+	unsigned int ticksSimulated = _currentGeneration.ticksSimulated;
+
+	if (!_currentGeneration.hasTicksSaved)
+	{
+		Log("Simulated " + std::to_string(ticksSimulated) + " ticks\n");
+		std::cout << "Generation " << _currentGenerationNum << " simulated " << ticksSimulated << " ticks" << std::endl;
+		return;
+	}
+
+	long long ticksSaved = _currentGeneration.ticksSaved;
+
+	Log("Simulated " + std::to_string(ticksSimulated) + " ticks, saved " + std::to_string(ticksSaved) + "\n");
+	std::cout << "Generation " << _currentGenerationNum << " simulated " << ticksSimulated << " ticks, saved " << ticksSaved << std::endl;
+}
+
+void AIController::LogGenerationStats(unsigned int seed)
+{
+	MEMORY_TAG(Logging);
+
+	// From the end of the last breeding, so the first generation after starting up only counts since then
+	double evaluationSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - s_evaluationStart).count();
+
+	GenerationStats stats = GenerationStats::Measure(_currentGeneration, _currentGenerationNum, seed, evaluationSeconds);
+	std::string binaryFilePath = s_filePrefix + GENERATION_STATS_FILEPATH;
+	std::string csvFilePath = s_filePrefix + GENERATION_STATS_CSV_FILEPATH;
+
+	Sonar::BackgroundWriter* writer = GetWriter();
+	if (writer == nullptr)
+		stats.Append(binaryFilePath, csvFilePath);
+	// Checked once a run, as after that nothing else adds to it
+	else if (s_statsAppendable || GenerationStats::CanAppend(binaryFilePath))
+	{
+		s_statsAppendable = true;
+		writer->Append(binaryFilePath, stats.GetRecord(), GenerationStats::GetHeader());
+		writer->Append(csvFilePath, stats.GetCsvLine(), GenerationStats::GetCsvHeader());
+	}
+
+	METRIC_SET(BestScore, stats.maxScore);
+	if (stats.scored > 0)
+		METRIC_SET(MeanScore, stats.meanScore);
+	if (evaluationSeconds > 0.0)
+		METRIC_SET(GenerationsPerHour, 3600.0 / evaluationSeconds);
+}
+
+void AIController::LogFootprint()
+{
+	// Nothing allocated here should land in the figures being written
+	MEMORY_TAG(Logging);
+
+	std::ostringstream header;
+	header << "generation";
+	for (int tag = 0; tag < (int)Sonar::MemoryTag::Count; tag++)
+	{
+		const char* name = Sonar::AllocationCounter::GetTagName((Sonar::MemoryTag)tag);
+		header << "," << name << "_live_bytes," << name << "_live_allocations," << name << "_allocations";
+	}
+	header << ",total_live_bytes,peak_rss_bytes,bird_bytes,network_bytes_per_chromosome,generation_bytes_per_chromosome\n";
+
+	std::ostringstream line;
+	line << _currentGenerationNum;
+	for (int tag = 0; tag < (int)Sonar::MemoryTag::Count; tag++)
+	{
+		Sonar::MemoryStats stats = Sonar::AllocationCounter::GetStats((Sonar::MemoryTag)tag);
+		line << "," << stats.liveBytes << "," << stats.liveAllocations << "," << stats.allocations;
+	}
+
+	// The networks are the only AI memory, and the generation most of the GA's
+	long long birdBytes = m_pGameState != nullptr ? m_pGameState->GetBirdFootprint() : 0;
+	line << "," << Sonar::AllocationCounter::GetTotalStats().liveBytes
+		<< "," << Sonar::ProcessStats::GetPeakResidentBytes()
+		<< "," << birdBytes
+		<< "," << Sonar::AllocationCounter::GetStats(Sonar::MemoryTag::AI).liveBytes / BIRD_COUNT
+		<< "," << Sonar::AllocationCounter::GetStats(Sonar::MemoryTag::GA).liveBytes / BIRD_COUNT << "\n";
+
+	std::string filePath = s_filePrefix + MEMORY_REPORT_FILEPATH;
+
+	Sonar::BackgroundWriter* writer = GetWriter();
+	if (writer != nullptr)
+	{
+		writer->Append(filePath, line.str(), header.str());
+		return;
+	}
+
+	bool writeHeader = !std::ifstream(filePath).good();
+
+	std::ofstream o(filePath, std::ios::out | std::ios::app);
+	if (writeHeader)
+		o << header.str();
+	o << line.str();
 }
 
 void AIController::CreateNewGeneration()
 {
+	MEMORY_TAG(GA);
+	static_assert(PARENT_COUNT * PARENT_COUNT == BIRD_COUNT, "Every pair of parents has one child, which has to fill the next generation");
+
+#if TRACING
+	// Every episode of the generation, from the end of the last breeding to the start of this one
+	std::chrono::steady_clock::time_point breedingStart = std::chrono::steady_clock::now();
+	TraceRecorder::Complete("Evaluation", s_evaluationStart, breedingStart, "generation", _currentGenerationNum);
+#endif
+
+	LogTicksSaved();
+#if MEMORY_ACCOUNTING
+	LogFootprint();
+#endif
+
 	// Generate a seed so that the results are repeatable
 	unsigned int seed = unsigned int(time(NULL));
-	if (_currentGeneration.contains("seed"))
-		seed = _currentGeneration["seed"];
+	if (s_breedingSeed != 0)
+		seed = s_breedingSeed + _currentGenerationNum;
+	if (_currentGeneration.hasSeed)
+		seed = _currentGeneration.seed;
 	else
-		_currentGeneration["seed"] = seed;
+	{
+		_currentGeneration.hasSeed = true;
+		_currentGeneration.seed = seed;
+	}
 	srand(seed);
+	LogGenerationStats(seed);
 	SaveCurrentGeneration();
+	RecordScores();
 
 	_currentChromosomeNum = 0;
 	_currentGenerationNum++;
+	_racingStage = 0;
+
+	PROFILE_PHASES();
 
 	// Parent genes for next generation
-	json winners[PARENT_COUNT];
+	Chromosome winners[PARENT_COUNT];
+	int winnerNums[PARENT_COUNT];
 	std::string winningChromosomes[PARENT_COUNT];
 
 	// Selection
@@ -339,7 +662,7 @@ void AIController::CreateNewGeneration()
 		{
 			Log(std::to_string(tournament[groupNum][i]) +
 				" (" +
-				std::to_string((int)_currentGeneration[JSON_CHROMOSOME + std::to_string(tournament[groupNum][i])][JSON_SCORE])
+				std::to_string(_currentGeneration.chromosomes[tournament[groupNum][i]].score)
 				+ ")");
 			if (i < tournament[groupNum].size() - 1)
 				Log(", ");
@@ -356,64 +679,36 @@ void AIController::CreateNewGeneration()
 		for (int i = 1; i < tournament[group].size(); i++)
 		{
 			int current = tournament[group][i];
-			if (_currentGeneration[JSON_CHROMOSOME + std::to_string(current)][JSON_SCORE]
-		> _currentGeneration[JSON_CHROMOSOME + std::to_string(max)][JSON_SCORE])
+			if (_currentGeneration.chromosomes[current].score > _currentGeneration.chromosomes[max].score)
 				max = current;
 		}
 
-		winners[group] = _currentGeneration[JSON_CHROMOSOME + std::to_string(max)];
+		winners[group] = _currentGeneration.chromosomes[max];
+		winnerNums[group] = max;
 		Log(std::to_string(max) +
 			"(" +
-			std::to_string((int)_currentGeneration[JSON_CHROMOSOME + std::to_string(max)][JSON_SCORE]) +
+			std::to_string(_currentGeneration.chromosomes[max].score) +
 			")");
 		if (group < PARENT_COUNT - 1)
 			Log(", ");
 	}
 	Log("\n");
 
-	_currentGeneration.clear();
+	_currentGeneration = Generation();
+
+	PROFILE_PHASE("Selection");
 
 
 	// Encode
 	for (int round = 0; round < PARENT_COUNT; round++)
 	{
-		json networkJSON = winners[round];
-
-		// Iterate through each Layer
-		for (int layer = 0; layer < HIDDEN_LAYER_COUNT; layer++)
-		{
-			json layerJSON = networkJSON[JSON_LAYER + std::to_string(layer)];
-
-			// Encode each Neuron in this Layer
-			for (int neuron = 0; neuron < NEURONS_PER_HIDDEN_LAYER; neuron++)
-			{
-				json neuronJSON = layerJSON[JSON_NEURON + std::to_string(neuron)];
-
-				for (float weight : neuronJSON[JSON_WEIGHTS])
-				{
-					int recast = *(int*)&weight;
-					winningChromosomes[round] += std::bitset<32>(recast).to_string();
-				}
-
-				float bias = neuronJSON[JSON_BIAS];
-				int recast = *(int*)&bias;
-				winningChromosomes[round] += std::bitset<32>(recast).to_string();
-			}
-		}
-
-		// Encode this Layer's Output Neuron
-		json outputJSON = networkJSON[JSON_OUTPUT];
-
-		for (float weight : outputJSON[JSON_WEIGHTS])
+		// The genes are already in encoding order
+		for (float gene : winners[round].genes)
 		{
-			int recast = *(int*)&weight;
+			int recast = *(int*)&gene;
 			winningChromosomes[round] += std::bitset<32>(recast).to_string();
 		}
 
-		float bias = outputJSON[JSON_BIAS];
-		int recast = *(int*)&bias;
-		winningChromosomes[round] += std::bitset<32>(recast).to_string();
-
 		/*for (float weight : winners[round]["weights"])
 		{
 			int recast = *(int*)&weight;
@@ -421,12 +716,25 @@ void AIController::CreateNewGeneration()
 		}*/
 	}
 
+	PROFILE_PHASE("Encode");
+
 	int bitsPerFloat = 32;
 	int currentChildChromsome = 0;
+	Breeding breedings[BIRD_COUNT];
 
 	for (int first = 0; first < PARENT_COUNT; first++)
 		for (int second = 0; second < PARENT_COUNT; second++)
 		{
+			PROFILE_PHASE_RESTART();
+
+			Breeding& breeding = breedings[currentChildChromsome];
+			breeding.parents[0] = winnerNums[first];
+			breeding.parents[1] = winnerNums[second];
+			breeding.crossover = first == second ? Crossover::Clone : Crossover::AlternateGenes;
+			// Each child mutates from its own seed, so it can be bred again from its parents alone
+			breeding.mutationSeed = GenomeHistory::GetMutationSeed(seed, currentChildChromsome);
+			std::minstd_rand mutation(breeding.mutationSeed);
+
 			std::string child;
 			if (first == second)
 				child = winningChromosomes[first];
@@ -462,61 +770,16 @@ void AIController::CreateNewGeneration()
 				children[2] += chromosomeB.substr(bitsPerGene * 2, bitsPerGene);*/
 			}
 
+			PROFILE_PHASE("Crossover");
+
 			int currentOffset = 0;
 
 			// ----- Decode
 
-			// Create a Network
-			json networkJSON;
+			// Into the new generation, a gene at a time
+			float* genes = _currentGeneration.chromosomes[currentChildChromsome].genes;
 
-			// Iterate through each Layer
-			for (int layer = 0; layer < HIDDEN_LAYER_COUNT; layer++)
-			{
-				json layerJSON;
-
-				// Decode all Neurons in this Layer
-				for (int neuron = 0; neuron < NEURONS_PER_HIDDEN_LAYER; neuron++)
-				{
-					json neuronJSON;
-
-					int weightCount = NEURONS_PER_HIDDEN_LAYER;
-					// If this is the first hidden layer, the inputs are the input values
-					if (layer == 0)
-						weightCount = INPUT_COUNT;
-
-					// Decode this Neuron's Weights
-					for (int i = 0; i < weightCount; i++)
-					{
-						int n = 0;
-						for (int i = 0; i < bitsPerFloat; ++i)
-							n |= (child[currentOffset + i] - 48) << 31 - i;
-						currentOffset += bitsPerFloat;
-						float decode = *(float*)&n;
-
-						neuronJSON[JSON_WEIGHTS].push_back(Mutate(decode));
-					}
-
-					// Decode this Neuron's Bias
-					int n = 0;
-					for (int i = 0; i < bitsPerFloat; ++i)
-						n |= (child[currentOffset + i] - 48) << 31 - i;
-					currentOffset += bitsPerFloat;
-					float decode = *(float*)&n;
-
-					neuronJSON[JSON_BIAS] = Mutate(decode);
-
-					// Add Neuron to Layer JSON
-					layerJSON[JSON_NEURON + std::to_string(neuron)] = neuronJSON;
-				}
-
-				// Add Layer to Network JSON
-				networkJSON[JSON_LAYER + std::to_string(layer)] = layerJSON;
-			}
-
-			// Decode this Layer's Output Neuron
-			json outputJSON;
-
-			for (int i = 0; i < NEURONS_PER_HIDDEN_LAYER; i++)
+			for (int gene = 0; gene < GENOME_SIZE; gene++)
 			{
 				int n = 0;
 				for (int i = 0; i < bitsPerFloat; ++i)
@@ -524,65 +787,200 @@ void AIController::CreateNewGeneration()
 				currentOffset += bitsPerFloat;
 				float decode = *(float*)&n;
 
-				outputJSON[JSON_WEIGHTS].push_back(Mutate(decode));
+				genes[gene] = GenomeHistory::Mutate(decode, _currentGenerationNum, mutation);
 			}
 
-			int n = 0;
-			for (int i = 0; i < bitsPerFloat; ++i)
-				n |= (child[currentOffset + i] - 48) << 31 - i;
-			currentOffset += bitsPerFloat;
-			float decode = *(float*)&n;
-
-			outputJSON[JSON_BIAS] = Mutate(decode);
-
-			// Add Output Neuron to Network JSON
-			networkJSON[JSON_OUTPUT] = outputJSON;
-
-			// Add to new Generation
-			_currentGeneration[JSON_CHROMOSOME + std::to_string(currentChildChromsome)] = networkJSON;
-
 			if (child.size() != currentOffset)
 				Log("ERROR! DECODING FAILED!\n");
 			currentChildChromsome++;
+
+			// Decoding the child, which is where each gene gets its chance to mutate
+			PROFILE_PHASE("Mutation");
 		}
 
 	SaveCurrentGeneration();
+	RecordHistory(breedings);
+
+#if GENOME_HISTORY_PRUNE
+	// Only once the history holds the parents with their scores and this generation follows on from them
+	if (s_historyScoredNum == _currentGenerationNum - 1 && s_historyGenerationNum == _currentGenerationNum)
+		PruneGeneration(_currentGenerationNum - 1);
+#endif
+
+	s_evaluationStart = std::chrono::steady_clock::now();
 }
 
 void AIController::SaveCurrentGeneration()
 {
-	std::ofstream o("generation_" + std::to_string(_currentGenerationNum) + ".json");
-	o << std::setw(4) << _currentGeneration << std::endl;
-	o.close();
+	PROFILE_SCOPE("SaveCurrentGeneration");
+	MEMORY_TAG(GA);
+
+	Sonar::BackgroundWriter* writer = GetWriter();
+	if (writer == nullptr)
+	{
+		GenerationFile::Save(GetGenerationFilePath(_currentGenerationNum), _currentGeneration);
+		return;
+	}
+
+	// Copying is all that happens here, printing and writing it happens on the writer's thread
+	std::shared_ptr<const Generation> snapshot = std::make_shared<const Generation>(_currentGeneration);
+	s_savedGeneration = snapshot;
+	s_savedGenerationNum = _currentGenerationNum;
+
+	writer->Write(GetGenerationFilePath(_currentGenerationNum), [snapshot](std::ostream& out)
+		{
+			MEMORY_TAG(GA);
+			GenerationFile::Write(out, *snapshot);
+		});
 }
 
-void AIController::Log(std::string output)
+void AIController::RecordHistory(const Breeding* breedings)
 {
-	//std::cout << output;
-	std::ofstream myfile;
-	myfile.open("log.txt", std::ios::out | std::ios::app);
-	myfile << output;
-	myfile.close();
+#if GENOME_HISTORY
+	PROFILE_SCOPE("RecordHistory");
+	MEMORY_TAG(GA);
+
+	// A bred record is only any use after the generation it was bred from
+	bool keyframe = breedings == nullptr || _currentGenerationNum % GENOME_HISTORY_KEYFRAME_INTERVAL == 0
+		|| s_historyGenerationNum != _currentGenerationNum - 1;
+
+	bool recorded = AppendToHistory(keyframe ? GenomeHistory::GetKeyframe(_currentGenerationNum, _currentGeneration)
+		: GenomeHistory::GetBred(_currentGenerationNum, breedings));
+
+	s_historyGenerationNum = recorded ? _currentGenerationNum : -1;
+#endif
 }
 
-float AIController::Mutate(float input)
+void AIController::RecordScores()
 {
-	// Mutation
-	if (rand() % 100 < 1)
-	{
-		float max = 1.0f;
+#if GENOME_HISTORY
+	PROFILE_SCOPE("RecordScores");
+	MEMORY_TAG(GA);
 
-		if (_currentGenerationNum < 100)
-			max -= _currentGenerationNum * 0.01f;
-		else
-			max = 0.01f;
+	// A generation carried on from an earlier run hasn't had its genes recorded by this one
+	if (s_historyGenerationNum != _currentGenerationNum)
+		RecordHistory(nullptr);
 
-		// Evaluates to between -max and max, and shrinks by 0.01 each generation. Then stays at 0.01.
-		float kohonenAdjustment = (static_cast <float> (rand()) / static_cast <float> (RAND_MAX / (max * 2))) - max;
+	if (s_historyGenerationNum == _currentGenerationNum && AppendToHistory(GenomeHistory::GetScores(_currentGenerationNum, _currentGeneration)))
+		s_historyScoredNum = _currentGenerationNum;
+#endif
+}
+
+bool AIController::AppendToHistory(const std::vector<char>& record)
+{
+	Sonar::BackgroundWriter* writer = GetWriter();
+	if (writer == nullptr)
+		return GenomeHistory::Append(GetGenomeHistoryFilePath(), record);
+
+	// Checked once a run, as after that nothing else adds to it. Appending happens on the writer's thread, after the generation's save
+	if (s_historyGenerationNum < 0 && !GenomeHistory::CanAppend(GetGenomeHistoryFilePath()))
+		return false;
+
+	writer->Append(GetGenomeHistoryFilePath(), std::string(record.begin(), record.end()), GenomeHistory::GetHeader());
+	return true;
+}
+
+void AIController::PruneGeneration(int generation)
+{
+	Sonar::BackgroundWriter* writer = GetWriter();
+	if (writer == nullptr)
+		std::remove(GetGenerationFilePath(generation).c_str());
+	else
+		// Queued behind the save and history records it's waiting on
+		writer->Remove(GetGenerationFilePath(generation));
+}
+
+int AIController::FindFirstGeneration()
+{
+	if (std::ifstream(GetGenerationFilePath(0)).good())
+		return 0;
+
+	GenomeHistory history;
+	if (!history.Open(GetGenomeHistoryFilePath()))
+		return 0;
 
-		std::cout << kohonenAdjustment << std::endl;
-		input += kohonenAdjustment;
+	// Pruning leaves the last generation recorded, unless it's still to be saved, and any before it not pruned yet
+	int generation = std::max(history.GetLastGeneration(), 0);
+	if (generation > 0 && !std::ifstream(GetGenerationFilePath(generation)).good())
+		generation--;
+	while (generation > 0 && std::ifstream(GetGenerationFilePath(generation - 1)).good())
+		generation--;
+
+	return generation;
+}
+
+Sonar::BackgroundWriter* AIController::GetWriter()
+{
+	return m_pGameState != nullptr ? m_pGameState->GetWriter() : nullptr;
+}
+
+void AIController::SetFilePrefix(const std::string& prefix)
+{
+	s_filePrefix = prefix;
+
+	// Everything remembered about the files under the old prefix
+	s_savedGeneration.reset();
+	s_historyGenerationNum = -1;
+	s_historyScoredNum = -1;
+	s_statsAppendable = false;
+	s_evaluationStart = std::chrono::steady_clock::time_point();
+}
+
+std::string AIController::GetGenerationFilePath(int generation)
+{
+	return s_filePrefix + GetGenerationFileName(generation);
+}
+
+std::string AIController::GetReplayFilePath(int generation, int stage, unsigned int startTick)
+{
+	return s_filePrefix + GetReplayFileName(generation, stage, startTick);
+}
+
+std::string AIController::GetGenerationFileName(int generation)
+{
+	return "generation_" + std::to_string(generation) + ".json";
+}
+
+std::string AIController::GetReplayFileName(int generation, int stage, unsigned int startTick)
+{
+	std::string resumed = startTick > 0 ? "_from_" + std::to_string(startTick) : "";
+	return "replay_" + std::to_string(generation) + "_" + std::to_string(stage) + resumed + ".rpl";
+}
+
+void AIController::RemoveFiles(const std::string& prefix)
+{
+	auto remove = [](const std::string& filePath)
+	{
+		std::remove(filePath.c_str());
+		std::remove(Sonar::BackgroundWriter::GetWritingPath(filePath).c_str());
+	};
+
+	// The index names every replay saved, resumed stages' included
+	for (const std::string& filePath : Sonar::ReplayLibrary::ListFiles(prefix + REPLAY_INDEX_FILEPATH))
+		remove(filePath);
+
+	// Pruning can leave the history's generations without files, so don't stop at the first missing one
+	GenomeHistory history;
+	int lastRecorded = history.Open(prefix + GENOME_HISTORY_FILEPATH) ? history.GetLastGeneration() : -1;
+	for (int generation = 0; generation <= lastRecorded || std::ifstream(prefix + GetGenerationFileName(generation)).good(); generation++)
+	{
+		remove(prefix + GetGenerationFileName(generation));
+		for (int stage = 0; stage < RACING_STAGE_COUNT; stage++)
+			remove(prefix + GetReplayFileName(generation, stage, 0));
 	}
-	return input;
+
+	for (const char* fileName : { "log.txt", REPLAY_INDEX_FILEPATH, CHECKPOINT_FILEPATH, GENOME_HISTORY_FILEPATH,
+		GENERATION_STATS_FILEPATH, GENERATION_STATS_CSV_FILEPATH, MEMORY_REPORT_FILEPATH })
+		remove(prefix + fileName);
 }
 
+void AIController::Log(std::string output)
+{
+	MEMORY_TAG(Logging);
+
+	//std::cout << output;
+	std::ofstream myfile;
+	myfile.open(s_filePrefix + "log.txt", std::ios::out | std::ios::app);
+	myfile << output;
+	myfile.close();
+}
@@ -1,10 +1,13 @@
 #pragma once
 
 #include "GameState.hpp"
-#include <nlohmann/json.hpp>
 #include "NeuralNetwork.h"
+#include "GenerationFile.h"
+#include "GenomeHistory.h"
 
-using json = nlohmann::json;
+#include <bitset>
+#include <chrono>
+#include <memory>
 
 class AIController
 {
@@ -12,18 +15,49 @@ public:
 	AIController();
 	~AIController();
 
-	void Init();
+	// False, with no chromosomes to fly, if a generation file is damaged and training has to stop
+	bool Init();
 
 	void setGameState(GameState* pGameState) { m_pGameState = pGameState; }
 	void update(Bird* bird);
 	bool shouldFlap(); // note when this is called, it resets the flap state
 
 	void BirdDied(Bird* bird, int score);
+	void BirdRetired(Bird* bird, int score);
 
+	void EndEpisode();
 	void CreateNewGeneration();
+	// Written behind by the game's writer if it has one, straight away if not
 	void SaveCurrentGeneration();
 	void Log(std::string output);
 
+	const std::vector<int>& GetActiveChromosomes() { return _activeChromosomes; }
+	unsigned int GetEpisodeTickLimit();
+	int GetCurrentGeneration() { return _currentGenerationNum; }
+	int GetRacingStage() { return _racingStage; }
+	// The tick this stage's birds took off from, later than 0 when they carry on from the stage before
+	unsigned int GetStageStartTick() { return _stageStartTick; }
+	void SetStageStartTick(unsigned int tick) { _stageStartTick = tick; }
+
+	// Scores recorded so far this episode, which only reach the generation's file once it ends
+	void SaveCheckpoint(Sonar::StateWriter& out);
+	// False, changing nothing, if the checkpoint is from another generation, stage or set of birds
+	bool LoadCheckpoint(Sonar::StateReader& in);
+
+	// Put in front of every file name, so a benchmark can keep out of the real run's files
+	static void SetFilePrefix(const std::string& prefix);
+	static std::string GetGenerationFilePath(int generation);
+	// Where GameState records each stage of a generation for REPLAY. A stage resumed from a
+	// checkpoint records from startTick into a file of its own, leaving what came before it
+	static std::string GetReplayFilePath(int generation, int stage, unsigned int startTick = 0);
+	static std::string GetReplayIndexFilePath() { return s_filePrefix + REPLAY_INDEX_FILEPATH; }
+	static std::string GetCheckpointFilePath() { return s_filePrefix + CHECKPOINT_FILEPATH; }
+	static std::string GetGenomeHistoryFilePath() { return s_filePrefix + GENOME_HISTORY_FILEPATH; }
+	// Every file a run with this prefix leaves behind, including resumed replays and half written .tmp files
+	static void RemoveFiles(const std::string& prefix);
+	// Breed from this seed plus the generation number instead of the clock, 0 to use the clock
+	static void SetBreedingSeed(unsigned int seed) { s_breedingSeed = seed; }
+
 public:
 
 private:
@@ -31,16 +65,53 @@ private:
 	float distanceToNearestPipes(Pipe* pipe, Bird* bird);
 	float distanceToCentreOfPipeGap(Pipe* pipe, Bird* bird);
 
-	float Mutate(float input);
+	void RecordEpisode(Bird* bird, int score);
+	void PromoteToNextStage();
+	void LogTicksSaved();
+	void LogFootprint();
+	void LogGenerationStats(unsigned int seed);
+	// Null breedings records the current generation in full
+	void RecordHistory(const Breeding* breedings);
+	// Once a generation finishes, recording its genes too if this run hasn't yet
+	void RecordScores();
+	// Behind the generation's save on the game's writer if it has one, straight away if not
+	bool AppendToHistory(const std::vector<char>& record);
+	void PruneGeneration(int generation);
+	// Where Init looks for the generation to carry on from, past any pruned ones
+	static int FindFirstGeneration();
+	static std::string GetGenerationFileName(int generation);
+	static std::string GetReplayFileName(int generation, int stage, unsigned int startTick);
+	Sonar::BackgroundWriter* GetWriter();
 private:
 	GameState*	m_pGameState;
 	bool		m_bShouldFlap;
 
 	std::vector<NeuralNetwork*> _neuralNetworks;
 
-	json _currentGeneration;
+	Generation _currentGeneration;
 	int _currentGenerationNum;
 	int _currentChromosomeNum;
 
+	// Chromosomes still to be scored in the current stage
+	std::vector<int> _activeChromosomes;
+	int _racingStage;
+	unsigned int _stageStartTick;
+	// Still flying when the stage's limit retired them, rather than dead
+	std::bitset<BIRD_COUNT> _retired;
+
+	static std::string s_filePrefix;
+	static unsigned int s_breedingSeed;
+	// The last generation handed to the writer, which might not have reached its file yet
+	static std::shared_ptr<const Generation> s_savedGeneration;
+	static int s_savedGenerationNum;
+	// The last generation this process added to the genome history, which a bred record has to follow on from
+	static int s_historyGenerationNum;
+	// The last generation it added the scores of
+	static int s_historyScoredNum;
+	// The stats file has been checked for a layout it can add to
+	static bool s_statsAppendable;
+	// When the generation being evaluated started, for its stats and the trace. Unset until the first Init
+	static std::chrono::steady_clock::time_point s_evaluationStart;
+
 };
 
@@ -0,0 +1,243 @@
+#include "AllocationCounter.hpp"
+
+#include <atomic>
+#include <cstdlib>
+#include <limits>
+#include <mutex>
+#include <new>
+#include <unordered_map>
+
+#ifdef _WIN32
+#include <malloc.h>
+#elif defined(__APPLE__)
+#include <malloc/malloc.h>
+#else
+#include <malloc.h>
+#endif
+
+namespace
+{
+	std::atomic<unsigned long long> s_allocations(0);
+	std::atomic<long long> s_liveBytes(0);
+	std::atomic<long long> s_liveAllocations(0);
+
+	std::size_t GetBlockSize(void* memory)
+	{
+#ifdef _WIN32
+		return _msize(memory);
+#elif defined(__APPLE__)
+		return malloc_size(memory);
+#else
+		return malloc_usable_size(memory);
+#endif
+	}
+
+#if MEMORY_ACCOUNTING
+	thread_local Sonar::MemoryTag t_tag = Sonar::MemoryTag::Untagged;
+
+	// The tracking table can't allocate through operator new, or every insert would recurse
+	template <typename T>
+	struct MallocAllocator
+	{
+		typedef T value_type;
+
+		MallocAllocator() { }
+		template <typename U> MallocAllocator(const MallocAllocator<U> &) { }
+
+		T* allocate(std::size_t count)
+		{
+			if (void* memory = std::malloc(count * sizeof(T)))
+				return static_cast<T*>(memory);
+			throw std::bad_alloc();
+		}
+
+		void deallocate(T* memory, std::size_t) { std::free(memory); }
+
+		template <typename U> bool operator==(const MallocAllocator<U> &) const { return true; }
+		template <typename U> bool operator!=(const MallocAllocator<U> &) const { return false; }
+	};
+
+	struct TaggedAllocation
+	{
+		// The block size, as the untagged totals count
+		std::size_t size;
+		Sonar::MemoryTag tag;
+	};
+
+	typedef std::unordered_map<void*, TaggedAllocation, std::hash<void*>, std::equal_to<void*>,
+		MallocAllocator<std::pair<void* const, TaggedAllocation>>> AllocationTable;
+
+	struct TagTotals
+	{
+		long long liveBytes = 0;
+		long long liveAllocations = 0;
+		unsigned long long allocations = 0;
+	};
+
+	// Frees can't tell what they are freeing, so only tagged allocations are
+	// remembered, and only looked up while some are still live
+	struct Tracking
+	{
+		std::mutex mutex;
+		AllocationTable table;
+		TagTotals totals[(int)Sonar::MemoryTag::Count];
+		std::atomic<long long> tracked{ 0 };
+	};
+
+	Tracking &GetTracking()
+	{
+		// Never destroyed, frees keep coming during static destruction
+		static Tracking* tracking = new (std::malloc(sizeof(Tracking))) Tracking();
+		return *tracking;
+	}
+#endif
+}
+
+#if ALLOCATION_HOOKS
+// Every other form of new and delete ends up in these two
+void* operator new(std::size_t size)
+{
+	void* memory = std::malloc(size > 0 ? size : 1);
+	if (memory == nullptr)
+		throw std::bad_alloc();
+
+	// What the allocator actually handed out, which tags count in too so they add up to the total
+	std::size_t blockSize = GetBlockSize(memory);
+
+	s_allocations.fetch_add(1, std::memory_order_relaxed);
+	s_liveBytes.fetch_add((long long)blockSize, std::memory_order_relaxed);
+	s_liveAllocations.fetch_add(1, std::memory_order_relaxed);
+
+#if MEMORY_ACCOUNTING
+	if (t_tag != Sonar::MemoryTag::Untagged)
+	{
+		Tracking &tracking = GetTracking();
+		std::lock_guard<std::mutex> lock(tracking.mutex);
+
+		tracking.table[memory] = TaggedAllocation{ blockSize, t_tag };
+		tracking.tracked++;
+
+		TagTotals &totals = tracking.totals[(int)t_tag];
+		totals.liveBytes += blockSize;
+		totals.liveAllocations++;
+		totals.allocations++;
+	}
+#endif
+
+	return memory;
+}
+
+void operator delete(void* memory) noexcept
+{
+	if (memory == nullptr)
+		return;
+
+	s_liveBytes.fetch_sub((long long)GetBlockSize(memory), std::memory_order_relaxed);
+	s_liveAllocations.fetch_sub(1, std::memory_order_relaxed);
+
+#if MEMORY_ACCOUNTING
+	Tracking &tracking = GetTracking();
+	if (tracking.tracked > 0)
+	{
+		std::lock_guard<std::mutex> lock(tracking.mutex);
+
+		AllocationTable::iterator found = tracking.table.find(memory);
+		if (found != tracking.table.end())
+		{
+			TagTotals &totals = tracking.totals[(int)found->second.tag];
+			totals.liveBytes -= found->second.size;
+			totals.liveAllocations--;
+
+			tracking.table.erase(found);
+			tracking.tracked--;
+		}
+	}
+#endif
+
+	std::free(memory);
+}
+#endif
+
+namespace Sonar
+{
+	MemoryTagScope::MemoryTagScope(MemoryTag tag)
+	{
+#if MEMORY_ACCOUNTING
+		_previous = t_tag;
+		t_tag = tag;
+#else
+		(void)tag;
+#endif
+	}
+
+	MemoryTagScope::~MemoryTagScope()
+	{
+#if MEMORY_ACCOUNTING
+		t_tag = _previous;
+#endif
+	}
+
+	namespace AllocationCounter
+	{
+		bool IsCounting()
+		{
+			return ALLOCATION_HOOKS;
+		}
+
+		unsigned long long GetCount()
+		{
+			return s_allocations.load(std::memory_order_relaxed);
+		}
+
+		MemoryStats GetTotalStats()
+		{
+			MemoryStats stats;
+			stats.liveBytes = s_liveBytes;
+			stats.liveAllocations = s_liveAllocations;
+			stats.allocations = s_allocations;
+
+			return stats;
+		}
+
+		MemoryStats GetStats(MemoryTag tag)
+		{
+			MemoryStats stats;
+
+#if MEMORY_ACCOUNTING
+			// Untagged is whatever the tags don't account for
+			if (MemoryTag::Untagged == tag)
+			{
+				stats = GetTotalStats();
+
+				for (int other = (int)MemoryTag::Untagged + 1; other < (int)MemoryTag::Count; other++)
+				{
+					MemoryStats tagged = GetStats((MemoryTag)other);
+					stats.liveBytes -= tagged.liveBytes;
+					stats.liveAllocations -= tagged.liveAllocations;
+					stats.allocations -= tagged.allocations;
+				}
+
+				return stats;
+			}
+
+			Tracking &tracking = GetTracking();
+			std::lock_guard<std::mutex> lock(tracking.mutex);
+
+			const TagTotals &totals = tracking.totals[(int)tag];
+			stats.liveBytes = totals.liveBytes;
+			stats.liveAllocations = totals.liveAllocations;
+			stats.allocations = totals.allocations;
+#else
+			(void)tag;
+#endif
+
+			return stats;
+		}
+
+		const char *GetTagName(MemoryTag tag)
+		{
+			static const char* names[] = { "untagged", "ai", "ga", "simulation", "assets", "logging" };
+			return names[(int)tag];
+		}
+	}
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include "DEFINITIONS.hpp"
+
+// Whether the global operator new is replaced at all
+#define ALLOCATION_HOOKS (COUNT_ALLOCATIONS || BENCHMARK || MEMORY_ACCOUNTING)
+
+#if MEMORY_ACCOUNTING
+#define MEMORY_TAG_CONCAT_INNER(a, b) a##b
+#define MEMORY_TAG_CONCAT(a, b) MEMORY_TAG_CONCAT_INNER(a, b)
+// Charges allocations made on this thread for the rest of the scope to tag
+#define MEMORY_TAG(tag) Sonar::MemoryTagScope MEMORY_TAG_CONCAT(_memoryTag, __LINE__)(Sonar::MemoryTag::tag)
+#else
+#define MEMORY_TAG(tag)
+#endif
+
+namespace Sonar
+{
+	// The subsystems memory is charged to. Anything allocated outside a MEMORY_TAG scope is Untagged.
+	enum class MemoryTag
+	{
+		Untagged,
+		AI,
+		GA,
+		Simulation,
+		Assets,
+		Logging,
+		Count
+	};
+
+	class MemoryTagScope
+	{
+	public:
+		MemoryTagScope(MemoryTag tag);
+		~MemoryTagScope();
+
+	private:
+		MemoryTag _previous;
+	};
+
+	struct MemoryStats
+	{
+		long long liveBytes = 0;
+		long long liveAllocations = 0;
+		unsigned long long allocations = 0;
+	};
+
+	// Counts every heap allocation in the program by replacing the global
+	// operator new. Only built in when ALLOCATION_HOOKS is set, otherwise
+	// the count stays at 0.
+	namespace AllocationCounter
+	{
+		bool IsCounting();
+
+		unsigned long long GetCount();
+
+		// Everything this module's operator delete has seen, by the heap's own block sizes
+		MemoryStats GetTotalStats();
+		// Memory allocated under tag by block size, like the totals, only tracked with MEMORY_ACCOUNTING
+		MemoryStats GetStats(MemoryTag tag);
+
+		const char *GetTagName(MemoryTag tag);
+	}
+}
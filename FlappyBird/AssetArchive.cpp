@@ -0,0 +1,229 @@
+#include "AssetArchive.hpp"
+
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace Sonar
+{
+	static const char ARCHIVE_MAGIC[4] = { 'F', 'B', 'P', 'K' };
+	static const std::uint32_t ARCHIVE_VERSION = 1;
+
+	AssetArchive::AssetArchive() : _data(nullptr), _size(0)
+	{
+#ifdef _WIN32
+		_file = INVALID_HANDLE_VALUE;
+		_mapping = nullptr;
+#endif
+	}
+
+	AssetArchive::~AssetArchive()
+	{
+		Close();
+	}
+
+	bool AssetArchive::Open(const std::string &fileName)
+	{
+		Close();
+
+#ifdef _WIN32
+		_file = CreateFileA(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (_file == INVALID_HANDLE_VALUE)
+			return false;
+
+		LARGE_INTEGER fileSize;
+		GetFileSizeEx(_file, &fileSize);
+		_size = (std::size_t)fileSize.QuadPart;
+
+		_mapping = CreateFileMappingA(_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (_mapping != nullptr)
+			_data = (const char*)MapViewOfFile(_mapping, FILE_MAP_READ, 0, 0, 0);
+#else
+		int file = open(fileName.c_str(), O_RDONLY);
+		if (file < 0)
+			return false;
+
+		struct stat status;
+		fstat(file, &status);
+		_size = (std::size_t)status.st_size;
+
+		void *mapping = mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, file, 0);
+		close(file);
+
+		if (mapping != MAP_FAILED)
+			_data = (const char*)mapping;
+#endif
+
+		if (_data == nullptr)
+		{
+			std::cout << "Error Mapping Asset Archive " << fileName << std::endl;
+			Close();
+			return false;
+		}
+
+		_fileName = fileName;
+
+		// Read the index, checking every read stays inside the file
+		std::size_t position = 0;
+		bool valid = true;
+
+		auto read = [&](void *destination, std::size_t count)
+		{
+			// position never passes _size, so this can't wrap
+			if (!valid || count > _size - position)
+			{
+				valid = false;
+				return;
+			}
+
+			std::memcpy(destination, _data + position, count);
+			position += count;
+		};
+
+		char magic[4];
+		std::uint32_t version = 0, count = 0;
+		read(magic, sizeof(magic));
+		read(&version, sizeof(version));
+		read(&count, sizeof(count));
+
+		if (!valid || std::memcmp(magic, ARCHIVE_MAGIC, sizeof(magic)) != 0 || version != ARCHIVE_VERSION)
+		{
+			std::cout << "Error " << fileName << " Is Not A Version " << ARCHIVE_VERSION << " Asset Archive" << std::endl;
+			Close();
+			return false;
+		}
+
+		for (std::uint32_t i = 0; i < count && valid; i++)
+		{
+			std::uint32_t pathLength = 0;
+			read(&pathLength, sizeof(pathLength));
+
+			// Before allocating, so a corrupt length can't ask for gigabytes
+			if (pathLength > _size - position)
+				valid = false;
+
+			std::string path(valid ? pathLength : 0, '\0');
+			read(&path[0], path.size());
+
+			Entry entry;
+			read(&entry.offset, sizeof(entry.offset));
+			read(&entry.size, sizeof(entry.size));
+
+			if (entry.offset > _size || entry.size > _size - entry.offset)
+				valid = false;
+
+			if (valid)
+				_entries[path] = entry;
+		}
+
+		if (!valid)
+		{
+			std::cout << "Error Asset Archive " << fileName << " Is Truncated" << std::endl;
+			Close();
+			return false;
+		}
+
+		return true;
+	}
+
+	void AssetArchive::Close()
+	{
+#ifdef _WIN32
+		if (_data != nullptr)
+			UnmapViewOfFile(_data);
+		if (_mapping != nullptr)
+			CloseHandle(_mapping);
+		if (_file != INVALID_HANDLE_VALUE)
+			CloseHandle(_file);
+
+		_file = INVALID_HANDLE_VALUE;
+		_mapping = nullptr;
+#else
+		if (_data != nullptr)
+			munmap((void*)_data, _size);
+#endif
+
+		_data = nullptr;
+		_size = 0;
+		_entries.clear();
+		_fileName.clear();
+	}
+
+	bool AssetArchive::Find(const std::string &path, const void *&data, std::size_t &size) const
+	{
+		std::map<std::string, Entry>::const_iterator found = _entries.find(path);
+		if (found == _entries.end())
+			return false;
+
+		data = _data + found->second.offset;
+		size = (std::size_t)found->second.size;
+		return true;
+	}
+
+	bool AssetArchive::Pack(const std::string &fileName, const std::vector<std::string> &paths)
+	{
+		std::vector<std::string> contents;
+
+		for (const std::string &path : paths)
+		{
+			std::ifstream file(path, std::ios::in | std::ios::binary);
+			if (!file.good())
+			{
+				std::cout << "Error Packing " << path << ", Couldn't Read It" << std::endl;
+				return false;
+			}
+
+			contents.push_back(std::string((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>()));
+		}
+
+		// The index comes first, so work out its size to know where the data starts
+		std::uint64_t offset = sizeof(ARCHIVE_MAGIC) + sizeof(ARCHIVE_VERSION) + sizeof(std::uint32_t);
+		for (const std::string &path : paths)
+			offset += sizeof(std::uint32_t) + path.size() + sizeof(std::uint64_t) * 2;
+
+		std::ofstream o(fileName, std::ios::out | std::ios::binary | std::ios::trunc);
+
+		std::uint32_t count = (std::uint32_t)paths.size();
+		o.write(ARCHIVE_MAGIC, sizeof(ARCHIVE_MAGIC));
+		o.write((const char*)&ARCHIVE_VERSION, sizeof(ARCHIVE_VERSION));
+		o.write((const char*)&count, sizeof(count));
+
+		for (std::size_t i = 0; i < paths.size(); i++)
+		{
+			std::uint32_t pathLength = (std::uint32_t)paths[i].size();
+			std::uint64_t size = contents[i].size();
+
+			o.write((const char*)&pathLength, sizeof(pathLength));
+			o.write(paths[i].data(), pathLength);
+			o.write((const char*)&offset, sizeof(offset));
+			o.write((const char*)&size, sizeof(size));
+
+			offset += size;
+		}
+
+		for (const std::string &content : contents)
+			o.write(content.data(), content.size());
+
+		o.close();
+
+		if (!o.good())
+		{
+			std::cout << "Error Writing Asset Archive " << fileName << std::endl;
+			return false;
+		}
+
+		std::cout << "Packed " << paths.size() << " Assets Into " << fileName << std::endl;
+		return true;
+	}
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace Sonar
+{
+	// Every resource file packed into one file, which is memory mapped in a
+	// single go and handed out to the SFML loadFromMemory functions.
+	//
+	// Layout: "FBPK", version, entry count, then per entry its path length,
+	// path, offset and size, followed by the file contents
+	class AssetArchive
+	{
+	public:
+		AssetArchive();
+		~AssetArchive();
+
+		bool Open(const std::string &fileName);
+		void Close();
+		bool IsOpen() const { return _data != nullptr; }
+
+		const std::string &GetFileName() const { return _fileName; }
+
+		// Where an entry's bytes are in the mapping, false if it isn't in the archive
+		bool Find(const std::string &path, const void *&data, std::size_t &size) const;
+
+		static bool Pack(const std::string &fileName, const std::vector<std::string> &paths);
+
+	private:
+		struct Entry
+		{
+			std::uint64_t offset;
+			std::uint64_t size;
+		};
+
+		std::string _fileName;
+		std::map<std::string, Entry> _entries;
+
+		const char *_data;
+		std::size_t _size;
+
+#ifdef _WIN32
+		void *_file;
+		void *_mapping;
+#endif
+	};
+}
@@ -1,35 +1,94 @@
 #include <SFML/Graphics.hpp>
 #include "AssetManager.hpp"
+#include "AllocationCounter.hpp"
+
+#include <iostream>
 
 namespace Sonar
 {
-	void AssetManager::LoadTexture(std::string name, std::string fileName)
+	template <typename T>
+	AssetHandle AssetManager::Load(Cache<T> &cache, const std::string &name, const std::string &fileName)
 	{
-		sf::Texture tex;
+		MEMORY_TAG(Assets);
+
+		std::map<std::string, AssetHandle>::iterator found = cache.handles.find(name);
+		if (found != cache.handles.end())
+		{
+			_stats.hits++;
+			return found->second;
+		}
 
-		if (tex.loadFromFile(fileName))
+		found = cache.files.find(fileName);
+		if (found != cache.files.end())
 		{
-			this->_textures[name] = tex;
+			_stats.hits++;
+			cache.handles[name] = found->second;
+			return found->second;
 		}
+
+		// Load straight into its final home rather than copying it in
+		std::unique_ptr<T> asset(new T());
+
+		bool loaded = false;
+
+		if (_archive.IsOpen())
+		{
+			const void *data;
+			std::size_t size;
+
+			if (_archive.Find(fileName, data, size))
+				loaded = asset->loadFromMemory(data, size);
+			else
+				std::cout << "Error " << _archive.GetFileName() << " Has No Entry For " << fileName << ", Trying The File Instead" << std::endl;
+		}
+
+		if (!loaded)
+			loaded = asset->loadFromFile(fileName);
+
+		if (!loaded)
+		{
+			std::cout << "Error Loading " << fileName << std::endl;
+			_stats.failures++;
+			return INVALID_ASSET_HANDLE;
+		}
+
+		_stats.loads++;
+
+		AssetHandle handle = (AssetHandle)cache.assets.size();
+		cache.assets.push_back(std::move(asset));
+		cache.handles[name] = handle;
+		cache.files[fileName] = handle;
+
+		return handle;
 	}
 
-	sf::Texture &AssetManager::GetTexture(std::string name)
+	AssetHandle AssetManager::LoadTexture(std::string name, std::string fileName)
 	{
-		return this->_textures.at(name);
+		return Load(_textures, name, fileName);
 	}
 
-	void AssetManager::LoadFont(std::string name, std::string fileName)
+	sf::Texture &AssetManager::GetTexture(std::string name)
 	{
-		sf::Font font;
+		return GetTexture(this->_textures.handles.at(name));
+	}
 
-		if (font.loadFromFile(fileName))
-		{
-			this->_fonts[name] = font;
-		}
+	AssetHandle AssetManager::LoadFont(std::string name, std::string fileName)
+	{
+		return Load(_fonts, name, fileName);
 	}
 
 	sf::Font &AssetManager::GetFont(std::string name)
 	{
-		return this->_fonts.at(name);
+		return GetFont(this->_fonts.handles.at(name));
+	}
+
+	AssetHandle AssetManager::LoadSound(std::string name, std::string fileName)
+	{
+		return Load(_sounds, name, fileName);
+	}
+
+	sf::SoundBuffer &AssetManager::GetSound(std::string name)
+	{
+		return GetSound(this->_sounds.handles.at(name));
 	}
-}
\ No newline at end of file
+}
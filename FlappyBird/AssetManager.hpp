@@ -1,24 +1,79 @@
 #pragma once
 
 #include <map>
+#include <memory>
+#include <string>
+#include <vector>
 #include <SFML/Graphics.hpp>
+#include <SFML/Audio.hpp>
+
+#include "AssetArchive.hpp"
 
 namespace Sonar
 {
+	// Index of a loaded asset, stays valid for the life of the AssetManager
+	typedef unsigned int AssetHandle;
+
+	const AssetHandle INVALID_ASSET_HANDLE = (AssetHandle)-1;
+
 	class AssetManager
 	{
 	public:
+		struct Stats
+		{
+			unsigned int loads = 0;		// Files actually read
+			unsigned int hits = 0;		// Load calls answered from the cache
+			unsigned int failures = 0;
+		};
+
 		AssetManager() { }
 		~AssetManager() { }
 
-		void LoadTexture(std::string name, std::string fileName);
+		// Each file is only ever loaded once, loading it again under any name just returns its handle
+		AssetHandle LoadTexture(std::string name, std::string fileName);
+		// INVALID_ASSET_HANDLE, from a file that failed to load, gets an empty placeholder
+		sf::Texture &GetTexture(AssetHandle handle) { return Get(_textures, handle); }
 		sf::Texture &GetTexture(std::string name);
 
-		void LoadFont(std::string name, std::string fileName);
+		AssetHandle LoadFont(std::string name, std::string fileName);
+		sf::Font &GetFont(AssetHandle handle) { return Get(_fonts, handle); }
 		sf::Font &GetFont(std::string name);
 
+		AssetHandle LoadSound(std::string name, std::string fileName);
+		sf::SoundBuffer &GetSound(AssetHandle handle) { return Get(_sounds, handle); }
+		sf::SoundBuffer &GetSound(std::string name);
+
+		// Reported by the throughput benchmark, where every generation loads the game's assets again
+		const Stats &GetStats() const { return _stats; }
+
+		// Once open, assets are read from the archive rather than from loose files
+		bool OpenArchive(std::string fileName) { return _archive.Open(fileName); }
+
 	private:
-		std::map<std::string, sf::Texture> _textures;
-		std::map<std::string, sf::Font> _fonts;
+		template <typename T>
+		struct Cache
+		{
+			// Held by pointer so references handed out never move
+			std::vector<std::unique_ptr<T>> assets;
+			std::map<std::string, AssetHandle> handles;
+			// The same handles by file, so a file used under several names is only loaded once
+			std::map<std::string, AssetHandle> files;
+			// Handed out for INVALID_ASSET_HANDLE
+			T missing;
+		};
+
+		template <typename T>
+		AssetHandle Load(Cache<T> &cache, const std::string &name, const std::string &fileName);
+		template <typename T>
+		T &Get(Cache<T> &cache, AssetHandle handle) { return handle < cache.assets.size() ? *cache.assets[handle] : cache.missing; }
+
+		// Fonts keep reading from the mapping after loading, so it must outlive the caches
+		AssetArchive _archive;
+
+		Cache<sf::Texture> _textures;
+		Cache<sf::Font> _fonts;
+		Cache<sf::SoundBuffer> _sounds;
+
+		Stats _stats;
 	};
 }
@@ -0,0 +1,289 @@
+#include "BackgroundWriter.hpp"
+#include "Metrics.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#endif
+
+namespace Sonar
+{
+	BackgroundWriter::BackgroundWriter() : _writing(false), _running(true)
+	{
+		_thread = std::thread(&BackgroundWriter::WriteLoop, this);
+	}
+
+	BackgroundWriter::~BackgroundWriter()
+	{
+		Flush();
+
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			_running = false;
+		}
+
+		_wake.notify_all();
+		_thread.join();
+	}
+
+	void BackgroundWriter::Write(const std::string &filePath, std::vector<char> &data)
+	{
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+
+			File &file = GetFile(filePath);
+			bool superseded = file.queued;
+
+			file.pending.swap(data);
+			file.serialise = nullptr;
+			file.remove = false;
+			file.append = false;
+
+			// A write that never started is thrown away and its buffer reused, otherwise the last one written is
+			if (!superseded)
+				data.swap(file.spare);
+			data.clear();
+
+			Queue(file);
+		}
+
+		_wake.notify_one();
+	}
+
+	void BackgroundWriter::Write(const std::string &filePath, std::function<void(std::ostream&)> serialise)
+	{
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+
+			File &file = GetFile(filePath);
+			file.pending.clear();
+			file.serialise = std::move(serialise);
+			file.remove = false;
+			file.append = false;
+
+			Queue(file);
+		}
+
+		_wake.notify_one();
+	}
+
+	void BackgroundWriter::Remove(const std::string &filePath)
+	{
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+
+			File &file = GetFile(filePath);
+			file.pending.clear();
+			file.serialise = nullptr;
+			file.remove = true;
+			file.append = false;
+
+			Queue(file);
+		}
+
+		_wake.notify_one();
+	}
+
+	void BackgroundWriter::Append(const std::string &filePath, const std::string &text, const std::string &header)
+	{
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+
+			File &file = GetFile(filePath);
+
+			// Otherwise the text goes on the end of whatever is queued already
+			if (!file.queued)
+			{
+				file.pending.clear();
+				file.append = true;
+				file.header = header;
+			}
+			else if (file.remove)
+			{
+				// It'll be gone by then, so this is the whole of the new file
+				file.pending.assign(header.begin(), header.end());
+				file.remove = false;
+			}
+
+			if (file.serialise)
+			{
+				std::function<void(std::ostream&)> serialise = std::move(file.serialise);
+				file.serialise = [serialise, text](std::ostream &out)
+				{
+					serialise(out);
+					out << text;
+				};
+			}
+			else
+				file.pending.insert(file.pending.end(), text.begin(), text.end());
+
+			Queue(file);
+		}
+
+		_wake.notify_one();
+	}
+
+	void BackgroundWriter::Reserve(const std::string &filePath, size_t bytes)
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+
+		File &file = GetFile(filePath);
+		if (file.spare.capacity() < bytes)
+			file.spare.reserve(bytes);
+	}
+
+	void BackgroundWriter::Flush()
+	{
+		std::unique_lock<std::mutex> lock(_mutex);
+
+		_idle.wait(lock, [this]() { return _queue.empty() && !_writing; });
+	}
+
+	BackgroundWriter::File &BackgroundWriter::GetFile(const std::string &filePath)
+	{
+		// Only ever a handful of files, each written again and again
+		for (File &file : _files)
+			if (file.filePath == filePath)
+				return file;
+
+		_files.push_back(File{ filePath, {}, nullptr, {}, false, false, false, {} });
+		return _files.back();
+	}
+
+	void BackgroundWriter::Queue(File &file)
+	{
+		// Takes the place of whatever was queued for the file, behind everything queued since
+		if (file.queued)
+			_queue.erase(std::find(_queue.begin(), _queue.end(), file.filePath));
+
+		file.queued = true;
+		_queue.push_back(file.filePath);
+
+		METRIC_SET(WriteQueueDepth, _queue.size());
+	}
+
+	void BackgroundWriter::Release(const std::string &filePath)
+	{
+		for (std::vector<File>::iterator file = _files.begin(); file != _files.end(); ++file)
+		{
+			if (file->filePath != filePath)
+				continue;
+
+			if (!file->queued && file->spare.capacity() == 0)
+				_files.erase(file);
+			return;
+		}
+	}
+
+	void BackgroundWriter::WriteLoop()
+	{
+		std::unique_lock<std::mutex> lock(_mutex);
+
+		while (true)
+		{
+			_wake.wait(lock, [this]() { return !_running || !_queue.empty(); });
+
+			if (_queue.empty())
+				return;
+
+			std::string filePath = _queue.front();
+			_queue.pop_front();
+
+			// Copied out, as Write can add files and move them while this one is written
+			File &file = GetFile(filePath);
+			bool remove = file.remove;
+			bool append = file.append;
+			std::string header;
+			header.swap(file.header);
+			std::vector<char> data;
+			data.swap(file.pending);
+			std::function<void(std::ostream&)> serialise;
+			serialise.swap(file.serialise);
+
+			file.queued = false;
+			_writing = true;
+			METRIC_SET(WriteQueueDepth, _queue.size());
+
+			lock.unlock();
+			if (remove)
+				std::remove(filePath.c_str());
+			else if (append)
+				AppendFile(filePath, data, header);
+			else
+				WriteFile(filePath, data, serialise);
+			// Lets go of whatever it held before the lock is taken again
+			serialise = nullptr;
+			lock.lock();
+
+			// The written buffer goes round again as the next Write's, serialised and removed files had none
+			if (data.capacity() > 0)
+				GetFile(filePath).spare.swap(data);
+			Release(filePath);
+
+			_writing = false;
+			if (_queue.empty())
+				_idle.notify_all();
+		}
+	}
+
+	bool BackgroundWriter::WriteFile(const std::string &filePath, const std::vector<char> &data, const std::function<void(std::ostream&)> &serialise)
+	{
+		std::string writingPath = GetWritingPath(filePath);
+
+		{
+			std::ofstream o(writingPath, std::ios::binary);
+			if (serialise)
+				serialise(o);
+			else
+				o.write(data.data(), data.size());
+			o.flush();
+
+			if (!o.good())
+			{
+				std::cout << "Error Writing " << writingPath << std::endl;
+				return false;
+			}
+		}
+
+		// Only once it's all there does it take the old file's place
+#ifdef _WIN32
+		bool moved = MoveFileExA(writingPath.c_str(), filePath.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+		bool moved = std::rename(writingPath.c_str(), filePath.c_str()) == 0;
+#endif
+
+		if (!moved)
+		{
+			std::cout << "Error Replacing " << filePath << std::endl;
+			return false;
+		}
+
+		return true;
+	}
+
+	bool BackgroundWriter::AppendFile(const std::string &filePath, const std::vector<char> &data, const std::string &header)
+	{
+		bool writeHeader = !std::ifstream(filePath).good();
+
+		std::ofstream o(filePath, std::ios::binary | std::ios::app);
+
+		if (writeHeader)
+			o << header;
+		o.write(data.data(), data.size());
+		o.flush();
+
+		if (!o.good())
+		{
+			std::cout << "Error Writing " << filePath << std::endl;
+			return false;
+		}
+
+		return true;
+	}
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace Sonar
+{
+	// Writes whole files on its own thread, so saving never holds up a tick.
+	// Each file is written beside itself and renamed over the old one, so a
+	// crash part way through leaves the last complete copy. Writing a file
+	// again before the last write of it started replaces that write rather
+	// than adding another, so a slow disk only ever costs the latest copy.
+	// Either way it goes to the back of the queue, so files always reach the
+	// disk in the order they were last asked for, and removing a checkpoint
+	// can't overtake the save that made it unnecessary.
+	class BackgroundWriter
+	{
+	public:
+		BackgroundWriter();
+		// Finishes everything still queued
+		~BackgroundWriter();
+
+		// Takes data by swapping it for an emptied buffer from an earlier write
+		// of the same file, so writing on a steady cadence stops allocating
+		void Write(const std::string &filePath, std::vector<char> &data);
+		// Runs serialise on the writer's thread to print straight into the file, so
+		// it should only read things nothing else will change, like a snapshot it holds
+		void Write(const std::string &filePath, std::function<void(std::ostream&)> serialise);
+		// Adds text to the end of the file, starting it with header if it doesn't exist yet.
+		// Queued like any other write, so it lands after everything asked for before it
+		void Append(const std::string &filePath, const std::string &text, const std::string &header);
+		// Deletes the file once anything queued for it is written, or instead of it
+		void Remove(const std::string &filePath);
+		// Hands back up to bytes of spare buffer for filePath, so the first Write needn't allocate
+		void Reserve(const std::string &filePath, size_t bytes);
+
+		// Blocks until everything queued so far is on disk
+		void Flush();
+
+		// Where a file is written before it's renamed over the old one, left behind by a crash part way through
+		static std::string GetWritingPath(const std::string &filePath) { return filePath + ".tmp"; }
+
+	private:
+		struct File
+		{
+			std::string filePath;
+			std::vector<char> pending;
+			std::function<void(std::ostream&)> serialise;
+			// What Write hands back, the last buffer written
+			std::vector<char> spare;
+			bool queued;
+			bool remove;
+			// pending goes on the end of the file rather than replacing it
+			bool append;
+			std::string header;
+		};
+
+		std::mutex _mutex;
+		// Only files with something queued or a buffer to hand back, so writing a new file every generation doesn't add up
+		std::vector<File> _files;
+		// Paths of the queued files, oldest first
+		std::deque<std::string> _queue;
+		bool _writing;
+		std::condition_variable _wake;
+		std::condition_variable _idle;
+
+		bool _running;
+		std::thread _thread;
+
+		// Expects _mutex to be held
+		File &GetFile(const std::string &filePath);
+		void Queue(File &file);
+		// Forgets filePath if nothing is queued for it and it has no buffer to hand back
+		void Release(const std::string &filePath);
+
+		void WriteLoop();
+		static bool WriteFile(const std::string &filePath, const std::vector<char> &data, const std::function<void(std::ostream&)> &serialise);
+		static bool AppendFile(const std::string &filePath, const std::vector<char> &data, const std::string &header);
+	};
+}
@@ -0,0 +1,488 @@
+#include "Benchmark.hpp"
+#include "GameState.hpp"
+#include "AIController.h"
+#include "NeuralNetwork.h"
+#include "Neuron.h"
+
+#include "AllocationCounter.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+
+namespace Sonar
+{
+	Benchmark::Benchmark() : _data(std::make_shared<GameData>()), _gameState(nullptr), _random(BENCHMARK_SEED), _results(json::array()), _sink(0)
+	{
+	}
+
+	bool Benchmark::Run()
+	{
+		srand(BENCHMARK_SEED);
+
+		// Leftovers from an interrupted run would be picked up as the generation to carry on from
+		AIController::SetFilePrefix(BENCHMARK_FILE_PREFIX);
+		// Breeding seeds itself from the clock otherwise, and the history check rebuilds what it bred
+		AIController::SetBreedingSeed(BENCHMARK_SEED);
+		AIController::RemoveFiles(BENCHMARK_FILE_PREFIX);
+
+		_data->assets.OpenArchive(ASSET_ARCHIVE_FILEPATH);
+
+		// Nothing is drawn, but textures need a context and everything is laid out against the window size
+		_data->window.create(sf::VideoMode(SCREEN_WIDTH, SCREEN_HEIGHT), "Benchmark", sf::Style::None);
+		_data->window.setVisible(false);
+
+		_gameState = new GameState(_data);
+		_gameState->Init();
+
+		// Fill the screen with pipes the same way a game does
+		Pipe* pipe = _gameState->GetPipeContainer();
+		const float dt = 1.0f / 60.0f;
+		float spawnTime = PIPE_SPAWN_FREQUENCY;
+
+		for (float time = 0; time < PIPE_SPAWN_FREQUENCY * 3; time += dt)
+		{
+			pipe->MovePipes(dt);
+
+			spawnTime += dt;
+			if (spawnTime > PIPE_SPAWN_FREQUENCY)
+			{
+				pipe->NextPipeOffset();
+
+				pipe->SpawnInvisiblePipe();
+				pipe->SpawnBottomPipe();
+				pipe->SpawnTopPipe();
+				pipe->SpawnScoringPipe();
+
+				spawnTime = 0;
+			}
+		}
+
+		static const unsigned int populations[] = BENCHMARK_POPULATIONS;
+
+		BenchmarkNeuron();
+		for (unsigned int population : populations)
+			BenchmarkNeuralNetwork(population);
+		for (unsigned int population : populations)
+			BenchmarkCollision(population);
+		BenchmarkMovePipes();
+		for (unsigned int population : populations)
+			BenchmarkSensing(population);
+		BenchmarkGenerationSave();
+		BenchmarkGenerationLoad();
+		BenchmarkCreateNewGeneration();
+		bool historyMatches = BenchmarkGenomeHistory();
+
+		_gameState->CleanUp();
+		delete _gameState;
+		_gameState = nullptr;
+
+		bool passed = CheckSteadyStateAllocations() && historyMatches;
+
+		AIController::RemoveFiles(BENCHMARK_FILE_PREFIX);
+		_data->window.close();
+
+		json output;
+		output["seed"] = BENCHMARK_SEED;
+		output["bird_count"] = BIRD_COUNT;
+		output["allocations_counted"] = AllocationCounter::IsCounting();
+		output["results"] = _results;
+		output["allocation_check"] = _allocationCheck;
+		output["genome_history_matches"] = historyMatches;
+
+		std::ofstream o(BENCHMARK_FILEPATH);
+		if (!o.good())
+		{
+			std::cout << "Error Writing " << BENCHMARK_FILEPATH << std::endl;
+			return false;
+		}
+
+		o << std::setw(4) << output << std::endl;
+
+		return passed;
+	}
+
+	void Benchmark::BenchmarkNeuron()
+	{
+		std::vector<float> weights = RandomInputs();
+		Neuron neuron(weights, weights[0]);
+		std::vector<float> inputs = RandomInputs();
+
+		Measure("Neuron::Calculate", 1, 1, [&]()
+			{
+				_sink = _sink + neuron.Calculate(inputs.data());
+			});
+	}
+
+	void Benchmark::BenchmarkNeuralNetwork(unsigned int population)
+	{
+		std::vector<NeuralNetwork*> networks;
+		std::vector<std::vector<float>> inputs;
+
+		for (unsigned int i = 0; i < population; i++)
+		{
+			networks.push_back(new NeuralNetwork(RandomGenome().data()));
+			inputs.push_back(RandomInputs());
+		}
+
+		Measure("NeuralNetwork::Calculate", population, population, [&]()
+			{
+				for (unsigned int i = 0; i < population; i++)
+					_sink = _sink + networks[i]->Calculate(inputs[i].data());
+			});
+
+		for (NeuralNetwork* network : networks)
+			delete network;
+	}
+
+	void Benchmark::BenchmarkCollision(unsigned int population)
+	{
+		Collision collision;
+		const std::vector<sf::Sprite> &pipeSprites = _gameState->GetPipeContainer()->GetSprites();
+
+		Bird bird(_data, 0);
+		const sf::Sprite &birdSprite = bird.GetSprite();
+
+		// Every bird against every pipe, as a step does
+		Measure("Collision::CheckSpriteCollision", population, population * (unsigned int)pipeSprites.size(), [&]()
+			{
+				for (unsigned int i = 0; i < population; i++)
+					for (const sf::Sprite &pipeSprite : pipeSprites)
+						_sink = _sink + collision.CheckSpriteCollision(birdSprite, 0.625f, pipeSprite, 1.0f, true);
+			});
+	}
+
+	void Benchmark::BenchmarkMovePipes()
+	{
+		Pipe* pipe = _gameState->GetPipeContainer();
+		const float dt = 1.0f / 60.0f;
+
+		// Back and forth, so the same pipes stay on screen however long this runs
+		Measure("Pipe::MovePipes", 0, 2, [&]()
+			{
+				pipe->MovePipes(dt);
+				pipe->MovePipes(-dt);
+			});
+	}
+
+	void Benchmark::BenchmarkSensing(unsigned int population)
+	{
+		AIController* controller = _gameState->GetAIController();
+
+		std::vector<Bird*> birds;
+		for (unsigned int i = 0; i < population; i++)
+			birds.push_back(new Bird(_data, i % BIRD_COUNT));
+
+		Measure("AIController::update", population, population, [&]()
+			{
+				for (Bird* bird : birds)
+				{
+					controller->update(bird);
+					_sink = _sink + controller->shouldFlap();
+				}
+			});
+
+		for (Bird* bird : birds)
+			delete bird;
+	}
+
+	void Benchmark::BenchmarkCreateNewGeneration()
+	{
+		AIController* controller = _gameState->GetAIController();
+
+		std::vector<Bird*> birds;
+		for (int i = 0; i < BIRD_COUNT; i++)
+			birds.push_back(new Bird(_data, i));
+
+		std::uniform_int_distribution<int> scores(0, 100);
+
+		MeasureWithSetup("AIController::CreateNewGeneration", BIRD_COUNT, [&]()
+			{
+				// Breeding needs every chromosome scored
+				for (Bird* bird : birds)
+					controller->BirdDied(bird, scores(_random));
+			}, [&]()
+			{
+				controller->CreateNewGeneration();
+			});
+
+		for (Bird* bird : birds)
+			delete bird;
+	}
+
+	void Benchmark::BenchmarkGenerationLoad()
+	{
+		std::string filePath = AIController::GetGenerationFilePath(_gameState->GetAIController()->GetCurrentGeneration());
+
+		// What AIController::Init does with a generation
+		Measure("Generation load", BIRD_COUNT, 1, [&]()
+			{
+				Generation generation;
+				GenerationFile::Load(filePath, generation);
+
+				for (const Chromosome& chromosome : generation.chromosomes)
+				{
+					NeuralNetwork* network = new NeuralNetwork(chromosome.genes);
+					delete network;
+				}
+			});
+	}
+
+	void Benchmark::BenchmarkGenerationSave()
+	{
+		AIController* controller = _gameState->GetAIController();
+
+		Measure("Generation save", BIRD_COUNT, 1, [&]()
+			{
+				controller->SaveCurrentGeneration();
+			});
+	}
+
+	bool Benchmark::BenchmarkGenomeHistory()
+	{
+#if GENOME_HISTORY
+		int lastGeneration = _gameState->GetAIController()->GetCurrentGeneration();
+		std::string filePath = AIController::GetGenomeHistoryFilePath();
+
+		GenomeHistory history;
+		if (!history.Open(filePath) || history.GetLastGeneration() != lastGeneration)
+		{
+			std::cout << "Error Genome history doesn't reach generation " << lastGeneration << std::endl;
+			return false;
+		}
+
+		for (int generationNum = 0; generationNum <= lastGeneration; generationNum++)
+		{
+			std::shared_ptr<const Generation> rebuilt = history.Rebuild(generationNum);
+
+			// A pruned generation only has to rebuild
+			Generation saved;
+			bool pruned = !GenerationFile::Load(AIController::GetGenerationFilePath(generationNum), saved);
+
+			for (int chromosome = 0; rebuilt && !pruned && chromosome < BIRD_COUNT; chromosome++)
+				if (std::memcmp(saved.chromosomes[chromosome].genes, rebuilt->chromosomes[chromosome].genes, sizeof(saved.chromosomes[chromosome].genes)) != 0)
+					rebuilt = nullptr;
+
+			if (!rebuilt)
+			{
+				std::cout << "Error Generation " << generationNum << " rebuilds differently from its file" << std::endl;
+				return false;
+			}
+		}
+
+		// From a freshly opened history, so it is bred from its keyframe every time
+		Measure("Genome history rebuild", BIRD_COUNT, 1, [&]()
+			{
+				GenomeHistory fresh;
+				fresh.Open(filePath);
+				_sink = fresh.Rebuild(lastGeneration)->chromosomes[0].genes[0];
+			});
+#endif
+
+		return true;
+	}
+
+	bool Benchmark::CheckSteadyStateAllocations()
+	{
+		bool passed = CheckAllocations(_allocationCheck["without_writer"]);
+
+		// Training saves through a writer, and with it everything the default flags record
+		_data->writer = std::make_shared<BackgroundWriter>();
+		passed = CheckAllocations(_allocationCheck["with_writer"]) && passed;
+		_data->writer.reset();
+
+		_allocationCheck["passed"] = passed;
+
+		return passed;
+	}
+
+	bool Benchmark::CheckAllocations(json &result)
+	{
+		const float dt = 1.0f / 60.0f;
+
+		_data->machine.AddState(StateRef(new GameState(_data)));
+		_data->machine.ProcessStateChanges();
+
+		unsigned int episodeTick = 0;
+		unsigned int steadyTicks = 0;
+		unsigned int deathTicks = 0;
+		unsigned int allocatingTicks = 0;
+
+		for (unsigned int tick = 0; tick < ALLOCATION_CHECK_TICKS; tick++)
+		{
+			GameState* gameState = static_cast<GameState*>(_data->machine.GetActiveState().get());
+			unsigned int living = gameState->GetLivingBirdCount();
+
+			unsigned long long allocations = AllocationCounter::GetCount();
+
+			gameState->HandleInput();
+			gameState->Update(dt);
+
+			allocations = AllocationCounter::GetCount() - allocations;
+			episodeTick++;
+
+			// A finished episode builds the next one, which isn't steady state, but a death only gets logged
+			if (episodeTick > ALLOCATION_CHECK_WARMUP_TICKS && living > 0 && !_data->machine.HasPendingChanges())
+			{
+				unsigned int deaths = living - gameState->GetLivingBirdCount();
+				unsigned long long allowed = (unsigned long long)deaths * ALLOCATION_CHECK_DEATH_ALLOCATIONS;
+
+				if (deaths > 0)
+					deathTicks++;
+				else
+					steadyTicks++;
+
+				if (allocations > allowed)
+				{
+					allocatingTicks++;
+					if (allocatingTicks <= 10)
+						std::cout << "Error " << allocations << " Allocations With " << deaths << " Deaths In Tick " << episodeTick << " Of An Episode" << std::endl;
+				}
+			}
+
+			if (_data->machine.HasPendingChanges())
+			{
+				_data->machine.ProcessStateChanges();
+				episodeTick = 0;
+
+				// The last episode's saves would otherwise be counted against this one's ticks
+				if (_data->writer)
+					_data->writer->Flush();
+			}
+		}
+
+		// Cleaned up and off the stack, so the next pass doesn't clean it up again when it replaces it
+		_data->machine.Clear();
+
+		if (_data->writer)
+			_data->writer->Flush();
+
+		result["steady_ticks"] = steadyTicks;
+		result["death_ticks"] = deathTicks;
+		result["allocating_ticks"] = allocatingTicks;
+		result["passed"] = allocatingTicks == 0;
+
+		std::cout << (_data->writer ? "With" : "Without") << " a writer, steady state ticks " << steadyTicks
+			<< ", with deaths " << deathTicks << ", over the limit " << allocatingTicks << std::endl;
+
+		if (steadyTicks == 0 || deathTicks == 0)
+			std::cout << "Error Too Few Ticks To Check, Raise ALLOCATION_CHECK_TICKS" << std::endl;
+
+		return allocatingTicks == 0;
+	}
+
+	std::vector<float> Benchmark::RandomGenome()
+	{
+		std::uniform_real_distribution<float> weights(-RANDOM_WIEGHT_MAX, RANDOM_WIEGHT_MAX);
+		std::uniform_real_distribution<float> biases(-RANDOM_BIAS_MAX, RANDOM_BIAS_MAX);
+
+		std::vector<float> genes(GENOME_SIZE);
+
+		for (int layer = 0; layer < HIDDEN_LAYER_COUNT; layer++)
+		{
+			for (int neuron = 0; neuron < NEURONS_PER_HIDDEN_LAYER; neuron++)
+			{
+				float* neuronGenes = genes.data() + GenerationFile::GetNeuronOffset(layer, neuron);
+				int weightCount = GenerationFile::GetWeightCount(layer);
+
+				for (int i = 0; i < weightCount; i++)
+					neuronGenes[i] = weights(_random);
+				neuronGenes[weightCount] = biases(_random);
+			}
+		}
+
+		float* outputGenes = genes.data() + GenerationFile::GetOutputOffset();
+		for (int i = 0; i < NEURONS_PER_HIDDEN_LAYER; i++)
+			outputGenes[i] = weights(_random);
+		outputGenes[NEURONS_PER_HIDDEN_LAYER] = biases(_random);
+
+		return genes;
+	}
+
+	std::vector<float> Benchmark::RandomInputs()
+	{
+		// Roughly the range of distances the birds actually sense
+		std::uniform_real_distribution<float> distances(-SCREEN_HEIGHT / 2.0f, SCREEN_HEIGHT / 2.0f);
+
+		std::vector<float> inputs;
+		for (int i = 0; i < INPUT_COUNT; i++)
+			inputs.push_back(distances(_random));
+
+		return inputs;
+	}
+
+	template <typename Operation>
+	void Benchmark::Measure(const std::string &name, unsigned int population, unsigned int opsPerCall, Operation operation)
+	{
+		// Warm up caches and anything lazily allocated
+		operation();
+
+		unsigned long long calls = 1;
+
+		while (true)
+		{
+			unsigned long long allocations = AllocationCounter::GetCount();
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+			for (unsigned long long call = 0; call < calls; call++)
+				operation();
+
+			double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+			allocations = AllocationCounter::GetCount() - allocations;
+
+			if (seconds >= BENCHMARK_MIN_TIME)
+			{
+				Record(name, population, calls * opsPerCall, seconds, allocations);
+				return;
+			}
+
+			calls *= 2;
+		}
+	}
+
+	template <typename Setup, typename Operation>
+	void Benchmark::MeasureWithSetup(const std::string &name, unsigned int population, Setup setup, Operation operation)
+	{
+		unsigned long long calls = 0;
+		unsigned long long allocations = 0;
+		double seconds = 0;
+
+		while (seconds < BENCHMARK_MIN_TIME)
+		{
+			setup();
+
+			unsigned long long allocationsBefore = AllocationCounter::GetCount();
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+			operation();
+
+			seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+			allocations += AllocationCounter::GetCount() - allocationsBefore;
+			calls++;
+		}
+
+		Record(name, population, calls, seconds, allocations);
+	}
+
+	void Benchmark::Record(const std::string &name, unsigned int population, unsigned long long ops, double seconds, unsigned long long allocations)
+	{
+		json result;
+		result["name"] = name;
+		result["population"] = population;
+		result["ops"] = ops;
+		result["ns_per_op"] = seconds * 1e9 / ops;
+		result["allocations_per_op"] = (double)allocations / ops;
+		result["ops_per_second"] = ops / seconds;
+
+		_results.push_back(result);
+
+		std::cout << std::left << std::setw(36) << name << std::right << std::setw(6) << population
+			<< std::fixed << std::setprecision(1) << std::setw(14) << seconds * 1e9 / ops << " ns/op"
+			<< std::setprecision(2) << std::setw(10) << (double)allocations / ops << " allocs/op"
+			<< std::setprecision(0) << std::setw(14) << ops / seconds << " ops/s" << std::endl;
+	}
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <string>
+#include <random>
+#include <nlohmann/json.hpp>
+
+#include "Game.hpp"
+
+using json = nlohmann::json;
+
+namespace Sonar
+{
+	class GameState;
+
+	// Times the AI and simulation hot paths against fixed seeds and inputs, so
+	// an optimisation can be compared against the code it replaced. Results
+	// go to BENCHMARK_FILEPATH as JSON as well as the console.
+	class Benchmark
+	{
+	public:
+		Benchmark();
+
+		bool Run();
+
+	private:
+		GameDataRef _data;
+		GameState *_gameState;
+
+		std::mt19937 _random;
+		json _results;
+
+		// Written to, so the work being timed can't be optimised away
+		volatile float _sink;
+
+		void BenchmarkNeuron();
+		void BenchmarkNeuralNetwork(unsigned int population);
+		void BenchmarkCollision(unsigned int population);
+		void BenchmarkMovePipes();
+		void BenchmarkSensing(unsigned int population);
+		void BenchmarkCreateNewGeneration();
+		void BenchmarkGenerationLoad();
+		void BenchmarkGenerationSave();
+		// Fails if any generation bred so far rebuilds differently from its file
+		bool BenchmarkGenomeHistory();
+
+		// Plays whole episodes without a writer and then with one, failing if any tick without a state change
+		// allocates, past ALLOCATION_CHECK_DEATH_ALLOCATIONS for each bird that died in it
+		bool CheckSteadyStateAllocations();
+		bool CheckAllocations(json &result);
+		json _allocationCheck;
+
+		std::vector<float> RandomGenome();
+		std::vector<float> RandomInputs();
+
+		// Calls operation in doubling batches until one takes BENCHMARK_MIN_TIME
+		template <typename Operation>
+		void Measure(const std::string &name, unsigned int population, unsigned int opsPerCall, Operation operation);
+		// For slow operations that need setting up untimed before every call
+		template <typename Setup, typename Operation>
+		void MeasureWithSetup(const std::string &name, unsigned int population, Setup setup, Operation operation);
+
+		void Record(const std::string &name, unsigned int population, unsigned long long ops, double seconds, unsigned long long allocations);
+	};
+}
@@ -7,12 +7,12 @@ namespace Sonar
 	{
 		_animationIterator = 0;
 
-		_animationFrames.push_back(this->_data->assets.GetTexture("Bird Frame 1"));
-		_animationFrames.push_back(this->_data->assets.GetTexture("Bird Frame 2"));
-		_animationFrames.push_back(this->_data->assets.GetTexture("Bird Frame 3"));
-		_animationFrames.push_back(this->_data->assets.GetTexture("Bird Frame 4"));
+		_animationFrames.push_back(&this->_data->assets.GetTexture("Bird Frame 1"));
+		_animationFrames.push_back(&this->_data->assets.GetTexture("Bird Frame 2"));
+		_animationFrames.push_back(&this->_data->assets.GetTexture("Bird Frame 3"));
+		_animationFrames.push_back(&this->_data->assets.GetTexture("Bird Frame 4"));
 
-		_birdSprite.setTexture(_animationFrames.at(_animationIterator));
+		_birdSprite.setTexture(*_animationFrames.at(_animationIterator));
 
 		_birdSprite.setPosition((_data->window.getSize().x / 4) - (_birdSprite.getGlobalBounds().width / 2), (_data->window.getSize().y / 2) - (_birdSprite.getGlobalBounds().height / 2));
 	
@@ -23,6 +23,7 @@ namespace Sonar
 		_birdSprite.setOrigin(origin);
 
 		_rotation = 0;
+		_movementTime = 0;
 		_id = id;
 	}
 
@@ -48,7 +49,7 @@ namespace Sonar
 				_animationIterator = 0;
 			}
 
-			_birdSprite.setTexture(_animationFrames.at(_animationIterator));
+			_birdSprite.setTexture(*_animationFrames.at(_animationIterator));
 
 			_clock.restart();
 		}
@@ -96,9 +97,11 @@ namespace Sonar
 			_birdSprite.setRotation(_rotation);
 		}
 
-		if (_movementClock.getElapsedTime().asSeconds() > FLYING_DURATION)
+		_movementTime += dt;
+
+		if (_movementTime > FLYING_DURATION)
 		{
-			_movementClock.restart();
+			_movementTime = 0;
 			_birdState = BIRD_STATE_FALLING;
 		}
 	}
@@ -108,7 +111,7 @@ namespace Sonar
 		if (IsDead())
 			return;
 
-		_movementClock.restart();
+		_movementTime = 0;
 		_birdState = BIRD_STATE_FLYING;
 	}
 
@@ -128,4 +131,26 @@ namespace Sonar
 	{
 		_birdState = BIRD_STATE_DEAD;
 	}
+
+	void Bird::SaveState(StateWriter &out) const
+	{
+		out.Write(_birdSprite.getPosition());
+		out.Write(_birdSprite.getRotation());
+		out.Write(_rotation);
+		out.Write(_movementTime);
+		out.Write(_birdState);
+		out.Write(_animationIterator);
+	}
+
+	void Bird::LoadState(StateReader &in)
+	{
+		_birdSprite.setPosition(in.Read<sf::Vector2f>());
+		_birdSprite.setRotation(in.Read<float>());
+		_rotation = in.Read<float>();
+		_movementTime = in.Read<float>();
+		_birdState = in.Read<int>();
+		_animationIterator = in.Read<unsigned int>() % _animationFrames.size();
+
+		_birdSprite.setTexture(*_animationFrames.at(_animationIterator));
+	}
 }
\ No newline at end of file
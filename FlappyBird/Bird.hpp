@@ -4,6 +4,7 @@
 
 #include "DEFINITIONS.hpp"
 #include "Game.hpp"
+#include "StateStream.hpp"
 
 #include <vector>
 
@@ -24,6 +25,9 @@ namespace Sonar
 		void Tap();
 
 		const sf::Sprite &GetSprite() const;
+		// The animation frame showing, and every frame in order
+		unsigned int GetFrame() const { return _animationIterator; }
+		const std::vector<const sf::Texture*> &GetFrames() const { return _animationFrames; }
 
 		void getHeight(int& x, int& y);
 
@@ -31,17 +35,23 @@ namespace Sonar
 		bool IsDead() { return BIRD_STATE_DEAD == _birdState; }
 
 		int GetID() { return _id; }
+
+		// Everything the flight depends on, for replay keyframes
+		void SaveState(StateWriter &out) const;
+		void LoadState(StateReader &in);
 	private:
 		GameDataRef _data;
 
 		sf::Sprite _birdSprite;
-		std::vector<sf::Texture> _animationFrames;
+		// Shared with the asset manager rather than copied, so every bird samples the same textures
+		std::vector<const sf::Texture*> _animationFrames;
 
 		unsigned int _animationIterator;
 
 		sf::Clock _clock;
 
-		sf::Clock _movementClock;
+		// Simulated time, not wall time, so the flight is the same however fast we tick
+		float _movementTime;
 
 		int _birdState;
 
@@ -13,7 +13,7 @@ namespace Sonar
 	{
 	}
 
-	bool Collision::CheckSpriteCollision(sf::Sprite sprite1, sf::Sprite sprite2)
+	bool Collision::CheckSpriteCollision(const sf::Sprite &sprite1, const sf::Sprite &sprite2)
 	{
 		sf::Rect<float> rect1 = sprite1.getGlobalBounds();
 		sf::Rect<float> rect2 = sprite2.getGlobalBounds();
@@ -28,13 +28,10 @@ namespace Sonar
 		}
 	}
 
-	bool Collision::CheckSpriteCollision(sf::Sprite sprite1, float scale1, sf::Sprite sprite2, float scale2, bool output)
+	bool Collision::CheckSpriteCollision(const sf::Sprite &sprite1, float scale1, const sf::Sprite &sprite2, float scale2, bool output)
 	{
-		sprite1.setScale(scale1, scale1);
-		sprite2.setScale(scale2, scale2);
-
-		sf::Rect<float> rect1 = sprite1.getGlobalBounds();
-		sf::Rect<float> rect2 = sprite2.getGlobalBounds();
+		sf::Rect<float> rect1 = GetScaledBounds(sprite1, scale1);
+		sf::Rect<float> rect2 = GetScaledBounds(sprite2, scale2);
 
 		if (output) {
 			//cout << "Bird distance to Column" << rect2.left - rect1.left << endl;
@@ -50,4 +47,16 @@ namespace Sonar
 			return false;
 		}
 	}
+
+	sf::FloatRect Collision::GetScaledBounds(const sf::Sprite &sprite, float scale)
+	{
+		// Built the same way sf::Transformable builds its transform
+		sf::Transform transform;
+		transform.translate(sprite.getPosition());
+		transform.rotate(sprite.getRotation());
+		transform.scale(scale, scale);
+		transform.translate(-sprite.getOrigin());
+
+		return transform.transformRect(sprite.getLocalBounds());
+	}
 }
\ No newline at end of file
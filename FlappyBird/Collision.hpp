@@ -10,8 +10,12 @@ namespace Sonar
 		Collision();
 		~Collision();
 
-		bool CheckSpriteCollision(sf::Sprite sprite1, sf::Sprite sprite2);
-		bool CheckSpriteCollision(sf::Sprite sprite1, float scale1, sf::Sprite sprite2, float scale2, bool output);
+		bool CheckSpriteCollision(const sf::Sprite &sprite1, const sf::Sprite &sprite2);
+		bool CheckSpriteCollision(const sf::Sprite &sprite1, float scale1, const sf::Sprite &sprite2, float scale2, bool output);
+
+	private:
+		// The bounds sprite would have with its scale set to scale, without copying it to find out
+		static sf::FloatRect GetScaledBounds(const sf::Sprite &sprite, float scale);
 
 	};
 }
\ No newline at end of file
@@ -0,0 +1,17 @@
+#include "Course.hpp"
+
+#include <random>
+
+namespace Sonar
+{
+	Course::Course(unsigned int seed, int maxOffset, unsigned int length) : _seed(seed)
+	{
+		// Use a generator of our own rather than rand() so the course doesn't
+		// depend on how many random numbers anything else has consumed
+		std::mt19937 generator(seed);
+
+		_offsets.reserve(length);
+		for (unsigned int i = 0; i < length; i++)
+			_offsets.push_back((std::uint16_t)(generator() % (maxOffset + 1)));
+	}
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <cstdint>
+
+#include "DEFINITIONS.hpp"
+
+namespace Sonar
+{
+	// A precomputed sequence of pipe gap offsets built from a seed.
+	// The course never changes after construction, so a single instance can be
+	// shared read-only between any number of worlds and threads.
+	class Course
+	{
+	public:
+		Course(unsigned int seed, int maxOffset, unsigned int length = COURSE_LENGTH);
+
+		// Offset of the gap for the pipe at pipeIndex, the course repeats once exhausted
+		int GetOffset(unsigned int pipeIndex) const { return _offsets[pipeIndex % _offsets.size()]; }
+
+		unsigned int GetSeed() const { return _seed; }
+		unsigned int GetLength() const { return (unsigned int)_offsets.size(); }
+
+	private:
+		unsigned int _seed;
+		std::vector<std::uint16_t> _offsets;
+	};
+
+	typedef std::shared_ptr<const Course> CourseRef;
+}
@@ -5,6 +5,50 @@
 
 #define SPLASH_STATE_SHOW_TIME 0.0
 
+// Simulated seconds per real second, 0 runs as many updates as fit between frames.
+// Page Up and Page Down double and halve it while running, End toggles as fast as possible
+#define SIMULATION_SPEED 1.0f
+#define MAX_SIMULATION_SPEED 1024.0f
+// Longest we keep simulating before drawing a frame, so the window stays responsive
+#define MAX_SIMULATION_TIME_PER_FRAME (1.0f / 30.0f)
+// How often the achieved simulation speed is measured
+#define SIMULATION_SPEED_SAMPLE_TIME 0.5f
+
+// Step the simulation on its own thread, drawing from the snapshots it publishes
+#define THREADED_SIMULATION true
+// Sprites that move further than this between snapshots were moved, not travelling, so aren't interpolated
+#define MAX_INTERPOLATION_DISTANCE 64.0f
+
+// Frames per second to draw at, 0 is unlimited. Ignored with VSYNC, which waits on the display instead
+#define VSYNC false
+#define FRAMERATE_LIMIT 60
+// Frames per second while the window isn't focused
+#define IDLE_FRAMERATE 4
+// Sleeps stop this many seconds short and spin the rest, as sleeping can overshoot
+#define FRAME_SLEEP_MARGIN 0.001f
+#define FRAME_CPU_SAMPLE_TIME 0.5f
+
+// Time PROFILE_SCOPE zones, compiled out entirely when false
+#define PROFILING false
+// Samples kept per zone for its percentiles
+#define PROFILER_HISTORY 256
+// Whether the HUD starts out showing the zones, F3 toggles it
+#define PROFILER_OVERLAY false
+#define PROFILER_OVERLAY_REFRESH 0.25f
+
+// Write every profiled zone to TRACE_FILEPATH as Chrome trace events
+#define TRACING false
+#define TRACE_FILEPATH "trace.json"
+// Events each thread can hold between flushes, any more are dropped
+#define TRACE_BUFFER_EVENTS 65536
+#define TRACE_FLUSH_INTERVAL 0.5f
+
+// Serve Prometheus metrics on http://localhost:METRICS_PORT/metrics while the game runs
+#define METRICS_ENDPOINT false
+#define METRICS_PORT 9464
+// Threads that get a counter slot to themselves, any more share
+#define METRICS_THREAD_SLOTS 8
+
 #define SPLASH_SCENE_BACKGROUND_FILEPATH "Resources/res/Splash Background.png"
 #define MAIN_MENU_BACKGROUND_FILEPATH "Resources/res/sky.png"
 #define GAME_BACKGROUND_FILEPATH "Resources/res/sky.png"
@@ -39,11 +83,28 @@
 #define POINT_SOUND_FILEPATH "Resources/audio/Point.wav"
 #define WING_SOUND_FILEPATH "Resources/audio/Wing.wav"
 
+// Run once with PACK_ASSETS to build the archive, every run after that loads from it if it exists
+#define ASSET_ARCHIVE_FILEPATH "Resources.pak"
+#define PACK_ASSETS false
+
 #define PIPE_MOVEMENT_SPEED 200.0f
 #define PIPE_SPAWN_FREQUENCY 1.5f
 
+#define COURSE_SEED 1
+#define COURSE_LENGTH 4096
+
 #define BIRD_ANIMATION_DURATION 0.4f
 
+// Draw pipes, land and birds as one vertex array per layer from a shared texture atlas
+#define BATCHED_RENDERING true
+#define ATLAS_WIDTH 1024
+#define ATLAS_PADDING 1
+
+// Only draw the best placed living birds in full, the rest of the population is drawn as points
+#define LOD_RENDERING true
+#define TRAINING_RENDER_TOP_K 10
+#define TRAINING_RENDER_TOP_K_STEP 5
+
 #define BIRD_STATE_STILL 1
 #define BIRD_STATE_FALLING 2
 #define BIRD_STATE_FLYING 3
@@ -51,12 +112,88 @@
 
 #define SILENT true
 #define EXPORT false
+// Play back training's recordings instead of training, starting at REPLAY_GENERATION.
+// [ and ] go to the previous and next generation, by REPLAY_BROWSE_STEP with Shift held
 #define REPLAY false
 #define REPLAY_GENERATION 42
+#define REPLAY_BROWSE_STEP 10
+// Recordings kept loaded, and how many generations either side are loaded ahead of time
+#define REPLAY_CACHE_SIZE 16
+#define REPLAY_PREFETCH_RADIUS 2
+// Record the decisions made in every episode while training, for REPLAY to play back
+#define REPLAY_RECORDING true
+#define REPLAY_INDEX_FILEPATH "replays.csv"
+// Ticks between keyframes, the most a seek has to simulate
+#define REPLAY_KEYFRAME_TICKS 600
+// Left and Right skip this many ticks through a replay, Home goes back to the start
+#define REPLAY_SEEK_TICKS 600
+
+// Save the whole world every CHECKPOINT_TICKS while training, and carry on from
+// there after a crash or close instead of starting the episode over
+#define CHECKPOINTING true
+#define CHECKPOINT_TICKS 1800
+#define CHECKPOINT_FILEPATH "checkpoint.bin"
+
+// A row is appended to both as each generation finishes, see GenerationStats.h
+#define GENERATION_STATS_FILEPATH "generation_stats.bin"
+#define GENERATION_STATS_CSV_FILEPATH "generation_stats.csv"
+
+// Also record every generation's genes in one file, most of them as how each
+// child was bred rather than the genes themselves, see GenomeHistory.h
+#define GENOME_HISTORY true
+#define GENOME_HISTORY_FILEPATH "genome_history.bin"
+// Generations between ones stored in full, the most a rebuild has to breed
+#define GENOME_HISTORY_KEYFRAME_INTERVAL 50
+// Rebuilt generations kept by a GenomeHistory
+#define GENOME_HISTORY_CACHE_SIZE 8
+// Delete each generation's file once the next is saved and the history can rebuild it
+// with its scores, leaving only the one being trained. EXPORT reads the rest back from the history
+#define GENOME_HISTORY_PRUNE false
+
+// Time the AI and simulation hot paths, write the results out and exit
+#define BENCHMARK false
+#define BENCHMARK_SEED 1
+#define BENCHMARK_POPULATIONS { 1, 10, 100, 1000 }
+// Each benchmark doubles its calls until a batch takes at least this many seconds
+#define BENCHMARK_MIN_TIME 0.25
+#define BENCHMARK_FILEPATH "benchmark.json"
+#define BENCHMARK_FILE_PREFIX "benchmark_"
+// Count every heap allocation, always on in BENCHMARK builds
+#define COUNT_ALLOCATIONS false
+// Charge live memory to the subsystem that allocated it, and write a footprint report every generation
+#define MEMORY_ACCOUNTING false
+#define MEMORY_REPORT_FILEPATH "memory.csv"
+// Ticks the allocation check plays, and how long an episode settles before its ticks have to be allocation free
+#define ALLOCATION_CHECK_TICKS 20000
+#define ALLOCATION_CHECK_WARMUP_TICKS 360
+// Most a tick may allocate for each bird that dies in it, for logging the death
+#define ALLOCATION_CHECK_DEATH_ALLOCATIONS 16
+
+// Train THROUGHPUT_GENERATIONS generations from a fixed seed without drawing, then compare against the baseline
+#define THROUGHPUT_BENCHMARK false
+#define THROUGHPUT_SEED 1
+#define THROUGHPUT_GENERATIONS 5
+#define THROUGHPUT_FILEPATH "throughput.json"
+// Written from the first run if it doesn't exist yet
+#define THROUGHPUT_BASELINE_FILEPATH "throughput_baseline.json"
+// How much worse than the baseline a measurement can be before it counts as a regression
+#define THROUGHPUT_TOLERANCE 0.1
+#define THROUGHPUT_FILE_PREFIX "throughput_"
 
 #define BIRD_COUNT 100
 #define PARENT_COUNT 10
 
+// Birds still alive at either limit are retired with their current score, 0 disables a limit
+#define EPISODE_TICK_LIMIT 36000
+#define EPISODE_SCORE_LIMIT 0
+
+// Successive halving, every chromosome flies the first stage and only the best
+// RACING_KEEP_FRACTION of each stage go on to fly the next, longer one. Stages share
+// one flight, so the ticks are where each ends and the next carries on from there
+#define RACING_STAGE_COUNT 3
+#define RACING_STAGE_TICKS { 1800, 7200, EPISODE_TICK_LIMIT }
+#define RACING_KEEP_FRACTION 0.5f
+
 #define RANDOM_WIEGHT_MAX 0.7f
 #define RANDOM_BIAS_MAX 0.7f
 
@@ -71,6 +208,11 @@
 #define JSON_WEIGHTS "weights"
 #define JSON_BIAS "bias"
 #define JSON_SCORE "score"
+#define JSON_STAGE "stage"
+#define JSON_TICKS "ticks"
+#define JSON_TICKS_SIMULATED "ticks_simulated"
+#define JSON_TICKS_SAVED "ticks_saved"
+#define JSON_SEED "seed"
 #define JSON_ ""
 
 #define GRAVITY 350.0f
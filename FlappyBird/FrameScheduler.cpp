@@ -0,0 +1,72 @@
+#include "FrameScheduler.hpp"
+#include "DEFINITIONS.hpp"
+#include "ProcessStats.hpp"
+
+#include <algorithm>
+#include <thread>
+#include <SFML/System/Sleep.hpp>
+
+namespace Sonar
+{
+	FrameScheduler::FrameScheduler(const sf::Clock &clock) : _clock(clock), _focused(true), _nextFrame(0), _sampleFrames(0), _cpuPerFrame(0)
+	{
+		_sampleStart = _clock.getElapsedTime().asSeconds();
+		_sampleCpuStart = ProcessStats::GetCpuTime();
+	}
+
+	void FrameScheduler::SetFocused(bool focused)
+	{
+		_focused = focused;
+
+		// Don't sit out the rest of a long idle frame once someone is looking again
+		_nextFrame = 0;
+	}
+
+	float FrameScheduler::GetFrameInterval() const
+	{
+		if (!_focused)
+			return 1.0f / IDLE_FRAMERATE;
+
+		// Vertical sync already holds display() back to the refresh rate
+		if (VSYNC || FRAMERATE_LIMIT <= 0)
+			return 0.0f;
+
+		return 1.0f / FRAMERATE_LIMIT;
+	}
+
+	bool FrameScheduler::IsFrameDue() const
+	{
+		return _clock.getElapsedTime().asSeconds() >= _nextFrame;
+	}
+
+	void FrameScheduler::FrameDrawn()
+	{
+		float now = _clock.getElapsedTime().asSeconds();
+
+		// Step on from the old deadline to keep an even pace, unless it has already been missed
+		_nextFrame = std::max(_nextFrame + GetFrameInterval(), now);
+
+		_sampleFrames++;
+
+		if (now - _sampleStart > FRAME_CPU_SAMPLE_TIME)
+		{
+			double cpu = ProcessStats::GetCpuTime();
+			_cpuPerFrame = (float)((cpu - _sampleCpuStart) * 1000.0 / _sampleFrames);
+
+			_sampleStart = now;
+			_sampleCpuStart = cpu;
+			_sampleFrames = 0;
+		}
+	}
+
+	void FrameScheduler::SleepUntil(float time) const
+	{
+		float remaining = time - _clock.getElapsedTime().asSeconds();
+
+		if (remaining > FRAME_SLEEP_MARGIN)
+			sf::sleep(sf::seconds(remaining - FRAME_SLEEP_MARGIN));
+
+		while (_clock.getElapsedTime().asSeconds() < time)
+			std::this_thread::yield();
+	}
+}
\ No newline at end of file
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <SFML/System/Clock.hpp>
+
+namespace Sonar
+{
+	// Decides when the next frame should be drawn, and sleeps until then rather
+	// than spinning on the clock. Frames slow right down while the window isn't
+	// focused, since nobody is watching them.
+	class FrameScheduler
+	{
+	public:
+		FrameScheduler(const sf::Clock &clock);
+
+		void SetFocused(bool focused);
+		bool IsFocused() const { return _focused; }
+
+		// Seconds between frames, 0 if frames aren't limited
+		float GetFrameInterval() const;
+
+		bool IsFrameDue() const;
+		float GetNextFrameTime() const { return _nextFrame; }
+		void FrameDrawn();
+
+		// Sleeps until the clock reaches time, finishing off with a short spin
+		// because a plain sleep can overshoot by a whole scheduler quantum
+		void SleepUntil(float time) const;
+
+		// Process CPU time per drawn frame in milliseconds, across every thread
+		float GetCpuPerFrame() const { return _cpuPerFrame; }
+
+	private:
+		const sf::Clock &_clock;
+
+		bool _focused;
+		float _nextFrame;
+
+		float _sampleStart;
+		double _sampleCpuStart;
+		unsigned int _sampleFrames;
+		float _cpuPerFrame;
+	};
+}
@@ -1,8 +1,15 @@
 #include "Game.hpp"
 #include "SplashState.hpp"
+#include "TraceRecorder.hpp"
+#include "Metrics.hpp"
+#include "MetricsServer.hpp"
 
 #include <stdlib.h>
 #include <time.h>
+#include <iostream>
+#include <algorithm>
+#include <chrono>
+#include <thread>
 
 
 namespace Sonar
@@ -11,23 +18,94 @@ namespace Sonar
 	{
 		srand((unsigned int)time(NULL));
 
+#if TRACING
+		TraceRecorder::Start(TRACE_FILEPATH);
+		TraceRecorder::SetThreadName("Main");
+#endif
+#if METRICS_ENDPOINT
+		MetricsServer::Start(METRICS_PORT);
+#endif
+
+		if (_data->assets.OpenArchive(ASSET_ARCHIVE_FILEPATH))
+			std::cout << "Loading Assets From " << ASSET_ARCHIVE_FILEPATH << std::endl;
+
 		_data->window.create(sf::VideoMode(width, height), title, sf::Style::Close | sf::Style::Titlebar);
+		_data->window.setVerticalSyncEnabled(VSYNC);
 		_data->machine.AddState(StateRef(new SplashState(this->_data)));
+		_data->writer = std::make_shared<BackgroundWriter>();
 
 		this->Run();
+
+		// While the writer is still there, so an episode closed part way through can save where it got to
+		_data->machine.Clear();
+
+		// Waits for whatever is still being saved
+		_data->writer.reset();
+
+#if METRICS_ENDPOINT
+		MetricsServer::Stop();
+#endif
+
+#if TRACING
+		TraceRecorder::Stop();
+#endif
 	}
 
 	void Game::Run()
 	{
+#if THREADED_SIMULATION
+		// The simulation thread only ever steps whatever state is active, so make sure there is one
+		this->_data->machine.ProcessStateChanges();
+
+		_running = true;
+		std::thread simulation(&Game::RunSimulation, this);
+
+		while (this->_data->window.isOpen())
+		{
+			_renderWaiting = true;
+			{
+				std::lock_guard<std::mutex> lock(this->_data->stateMutex);
+				_renderWaiting = false;
+
+				this->_data->machine.ProcessStateChanges();
+				PollEvents();
+			}
+
+			{
+				std::lock_guard<std::mutex> lock(_stateChangeMutex);
+
+				if (_stateChangeRequested)
+				{
+					_stateChangeRequested = false;
+					_stateChange.notify_all();
+				}
+			}
+
+			// Drawing only reads published snapshots, so the simulation keeps going meanwhile
+			if (_scheduler.IsFrameDue())
+				DrawFrame(0.0f);
+
+			WaitForFrame();
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(_stateChangeMutex);
+			_running = false;
+		}
+
+		_stateChange.notify_all();
+		simulation.join();
+#else
 		float newTime, frameTime, interpolation;
 
 		float currentTime = this->_clock.getElapsedTime().asSeconds();
-		float accumulator = 0.0f;
 
 		while (this->_data->window.isOpen())
 		{
 			this->_data->machine.ProcessStateChanges();
 
+			PollEvents();
+
 			newTime = this->_clock.getElapsedTime().asSeconds();
 			frameTime = newTime - currentTime;
 
@@ -37,18 +115,222 @@ namespace Sonar
 			}
 
 			currentTime = newTime;
-			accumulator += frameTime;
 
-			while (accumulator >= dt)
+			Simulate(frameTime);
+
+			if (_scheduler.IsFrameDue())
+			{
+				interpolation = _accumulator / dt;
+				DrawFrame(interpolation);
+			}
+
+			// Sleep until either the next step or the next frame is due, whichever is sooner
+			float speed = this->_data->simulationSpeed;
+			if (speed > 0.0f)
+			{
+				float nextStep = this->_data->clock.getElapsedTime().asSeconds() + (dt - _accumulator) / speed;
+				_scheduler.SleepUntil(std::min(nextStep, _scheduler.GetNextFrameTime()));
+			}
+		}
+#endif
+	}
+
+	void Game::RunSimulation()
+	{
+#if TRACING
+		TraceRecorder::SetThreadName("Simulation");
+#endif
+
+		float currentTime = this->_clock.getElapsedTime().asSeconds();
+
+		while (_running)
+		{
+			float newTime = this->_clock.getElapsedTime().asSeconds();
+			float frameTime = std::min(newTime - currentTime, 0.25f);
+			currentTime = newTime;
+
+			int steps = Simulate(frameTime);
+
+			// std::mutex isn't fair, so let the render thread in before taking the states back for another batch
+			while (_renderWaiting && _running)
+				std::this_thread::yield();
+
+			// Nothing more can be stepped until the render thread has changed state
+			{
+				std::unique_lock<std::mutex> lock(_stateChangeMutex);
+				_stateChange.wait(lock, [this]() { return !_stateChangeRequested || !_running; });
+			}
+
+			// Sleep until the next step is due rather than spinning on the clock
+			float speed = this->_data->simulationSpeed;
+			if (speed > 0.0f && _accumulator < dt)
+				_scheduler.SleepUntil(this->_data->clock.getElapsedTime().asSeconds() + (dt - _accumulator) / speed);
+			else if (steps == 0)
+				sf::sleep(sf::milliseconds(1));
+		}
+	}
+
+	int Game::Simulate(float frameTime)
+	{
+		float speed = this->_data->simulationSpeed;
+		bool asFastAsPossible = speed <= 0.0f;
+
+		if (!asFastAsPossible)
+			_accumulator += frameTime * speed;
+
+		float start = this->_clock.getElapsedTime().asSeconds();
+		int steps = 0;
+
+#if THREADED_SIMULATION
+		// Once a batch rather than once a step, MAX_SIMULATION_TIME_PER_FRAME bounds how long the render thread waits
+		std::unique_lock<std::mutex> lock(this->_data->stateMutex);
+#endif
+
+		while (asFastAsPossible || _accumulator >= dt)
+		{
+			if (!Step())
+				break;
+
+			_accumulator -= dt;
+			_simulatedTime += dt;
+			steps++;
+
+			// Give up the rest of this frame's steps if the simulation can't keep
+			// up, dropping whatever it is behind by rather than catching up later
+			if (this->_clock.getElapsedTime().asSeconds() - start > MAX_SIMULATION_TIME_PER_FRAME)
 			{
-				this->_data->machine.GetActiveState()->HandleInput();
-				this->_data->machine.GetActiveState()->Update(dt);
+				if (_accumulator > dt)
+					_accumulator = 0.0f;
+				break;
+			}
+		}
+
+#if THREADED_SIMULATION
+		lock.unlock();
+#endif
 
-				accumulator -= dt;
+		if (asFastAsPossible || _accumulator < 0.0f)
+			_accumulator = 0.0f;
+
+		float now = this->_clock.getElapsedTime().asSeconds();
+		if (now - _sampleStart > SIMULATION_SPEED_SAMPLE_TIME)
+		{
+			this->_data->achievedSimulationSpeed = _simulatedTime / (now - _sampleStart);
+			METRIC_SET(SimulationSpeed, _simulatedTime / (now - _sampleStart));
+			METRIC_SET(TicksPerSecond, _simulatedTime / dt / (now - _sampleStart));
+			_sampleStart = now;
+			_simulatedTime = 0.0f;
+		}
+
+		return steps;
+	}
+
+	bool Game::Step()
+	{
+		// With THREADED_SIMULATION, Simulate holds stateMutex around this
+		// The active state is about to go, so don't step it any further
+		if (this->_data->machine.HasPendingChanges())
+		{
+#if THREADED_SIMULATION
+			{
+				std::lock_guard<std::mutex> changeLock(_stateChangeMutex);
+				_stateChangeRequested = true;
 			}
 
-			interpolation = accumulator / dt;
-			this->_data->machine.GetActiveState()->Draw(interpolation);
+			_stateChange.notify_all();
+#endif
+			return false;
 		}
+
+		this->_data->machine.GetActiveState()->HandleInput();
+		this->_data->machine.GetActiveState()->Update(dt);
+
+		return true;
+	}
+
+	void Game::WaitForFrame()
+	{
+		float nextFrame = _scheduler.GetNextFrameTime();
+
+		{
+			std::unique_lock<std::mutex> lock(_stateChangeMutex);
+
+			// Leaves the last of the wait to SleepUntil's spin, as waking from a wait can be just as late as a sleep
+			float remaining = nextFrame - this->_data->clock.getElapsedTime().asSeconds() - FRAME_SLEEP_MARGIN;
+			if (remaining > 0.0f)
+				_stateChange.wait_for(lock, std::chrono::duration<float>(remaining), [this]() { return _stateChangeRequested; });
+
+			if (_stateChangeRequested)
+				return;
+		}
+
+		_scheduler.SleepUntil(nextFrame);
+	}
+
+	void Game::DrawFrame(float interpolation)
+	{
+		this->_data->machine.GetActiveState()->Draw(interpolation);
+
+		_scheduler.FrameDrawn();
+		this->_data->cpuPerFrame = _scheduler.GetCpuPerFrame();
+	}
+
+	void Game::PollEvents()
+	{
+		sf::Event event;
+		while (this->_data->window.pollEvent(event))
+		{
+			HandleEvent(event);
+			this->_data->machine.GetActiveState()->HandleEvent(event);
+		}
+	}
+
+	void Game::HandleEvent(const sf::Event &event)
+	{
+		if (sf::Event::Closed == event.type)
+		{
+			this->_data->window.close();
+		}
+
+		if (sf::Event::LostFocus == event.type)
+			_scheduler.SetFocused(false);
+		else if (sf::Event::GainedFocus == event.type)
+			_scheduler.SetFocused(true);
+
+		if (sf::Event::KeyPressed != event.type)
+			return;
+
+		float speed = this->_data->simulationSpeed;
+
+		if (sf::Keyboard::PageUp == event.key.code && speed > 0.0f)
+			speed = std::min(speed * 2.0f, MAX_SIMULATION_SPEED);
+		else if (sf::Keyboard::PageDown == event.key.code && speed > 0.0f)
+			speed = speed / 2.0f;
+#if PROFILING
+		else if (sf::Keyboard::F3 == event.key.code)
+		{
+			this->_data->showProfiler = !this->_data->showProfiler;
+			return;
+		}
+#endif
+		else if (sf::Keyboard::End == event.key.code)
+		{
+			if (speed > 0.0f)
+			{
+				_lastSimulationSpeed = speed;
+				speed = 0.0f;
+			}
+			else
+				speed = _lastSimulationSpeed;
+		}
+		else
+			return;
+
+		this->_data->simulationSpeed = speed;
+
+		if (speed > 0.0f)
+			std::cout << "Simulation speed x" << speed << std::endl;
+		else
+			std::cout << "Simulation speed as fast as possible" << std::endl;
 	}
 }
\ No newline at end of file
@@ -1,11 +1,20 @@
 #pragma once
 
+#include <atomic>
+#include <condition_variable>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <SFML/Graphics.hpp>
 #include "StateMachine.hpp"
 #include "AssetManager.hpp"
 #include "InputManager.hpp"
+#include "DEFINITIONS.hpp"
+#include "Course.hpp"
+#include "TextureAtlas.hpp"
+#include "FrameScheduler.hpp"
+#include "ReplayLibrary.hpp"
+#include "BackgroundWriter.hpp"
 
 namespace Sonar
 {
@@ -15,6 +24,33 @@ namespace Sonar
 		sf::RenderWindow window;
 		AssetManager assets;
 		InputManager input;
+		// Shared by every GameState so each generation flies the same pipes
+		CourseRef course;
+		TextureAtlas atlas;
+		// What REPLAY can play, and the recording it is playing again each episode
+		std::shared_ptr<ReplayLibrary> replays;
+		std::shared_ptr<const ReplayRecording> replay;
+		unsigned int replayEntry = 0;
+		// Saves files without holding up the simulation, none when nothing should be saved in the background
+		std::shared_ptr<BackgroundWriter> writer;
+		// The world as the last racing stage reached its limit, for the birds it promoted to fly on from
+		std::vector<char> stageEnd;
+
+		// How many birds are drawn in full, adjustable while training
+		unsigned int renderTopK = TRAINING_RENDER_TOP_K;
+
+		// Simulated seconds per real second, 0 is as fast as possible
+		std::atomic<float> simulationSpeed{ SIMULATION_SPEED };
+		std::atomic<float> achievedSimulationSpeed{ 0.0f };
+		// Milliseconds of process CPU time per drawn frame
+		float cpuPerFrame = 0;
+
+		bool showProfiler = PROFILER_OVERLAY;
+
+		// Shared between the simulation and render threads
+		sf::Clock clock;
+		// Held while a state is stepped, and while states change or handle events
+		std::mutex stateMutex;
 	};
 
 	typedef std::shared_ptr<GameData> GameDataRef;
@@ -30,7 +66,36 @@ namespace Sonar
 		sf::Clock _clock;
 
 		GameDataRef _data = std::make_shared<GameData>();
+		FrameScheduler _scheduler{ _data->clock };
+
+		// Speed to go back to when leaving as fast as possible mode
+		float _lastSimulationSpeed = SIMULATION_SPEED;
+
+		// Simulated time still owed, and what was simulated since the speed was last measured
+		float _accumulator = 0.0f;
+		float _sampleStart = 0.0f;
+		float _simulatedTime = 0.0f;
+
+		std::atomic<bool> _running{ false };
+		// Set while the render thread is waiting for stateMutex, so the simulation hands it over between batches
+		std::atomic<bool> _renderWaiting{ false };
+
+		// Raised by the simulation when the active state is about to go, so the render loop
+		// changes it straight away rather than at its next frame, and lowered once it has
+		std::mutex _stateChangeMutex;
+		std::condition_variable _stateChange;
+		bool _stateChangeRequested = false;
 
 		void Run();
+		void RunSimulation();
+		int Simulate(float frameTime);
+		bool Step();
+
+		// Sleeps until the next frame is due, or until the simulation is waiting on a state change
+		void WaitForFrame();
+
+		void DrawFrame(float interpolation);
+		void PollEvents();
+		void HandleEvent(const sf::Event &event);
 	};
 }
\ No newline at end of file
@@ -93,21 +93,12 @@ namespace Sonar
         _medal.setPosition( 175, 465 );
     }
     
-    void GameOverState::HandleInput()
+    void GameOverState::HandleEvent(const sf::Event &event)
     {
-        sf::Event event;
-        
-        while (this->_data->window.pollEvent(event))
+        // Once per press rather than once per event while the button is held
+        if (sf::Event::MouseButtonPressed == event.type && this->_data->input.IsSpriteClicked(this->_retryButton, sf::Mouse::Left, this->_data->window))
         {
-            if (sf::Event::Closed == event.type)
-            {
-                this->_data->window.close();
-            }
-            
-            if (this->_data->input.IsSpriteClicked(this->_retryButton, sf::Mouse::Left, this->_data->window))
-            {
-                this->_data->machine.AddState(StateRef(new GameState(_data)), true);
-            }
+            this->_data->machine.AddState(StateRef(new GameState(_data)), true);
         }
     }
     
@@ -14,7 +14,8 @@ namespace Sonar
         void Init();
         void CleanUp() {}
         
-        void HandleInput();
+        void HandleEvent(const sf::Event &event);
+        void HandleInput() {}
         void Update(float dt);
         void Draw(float dt);
         
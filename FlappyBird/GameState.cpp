@@ -5,15 +5,33 @@
 #include "GameState.hpp"
 #include "GameOverState.hpp"
 #include "AIController.h"
+#include "Profiler.hpp"
+#include "AllocationCounter.hpp"
+#include "Metrics.hpp"
 
 #include <iostream>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iterator>
 
 #define PLAY_WITH_AI 1
 
 namespace Sonar
 {
-	GameState::GameState(GameDataRef data) : _data(data)
+	namespace
 	{
+		const unsigned int CHECKPOINT_MAGIC = 0x50434246; // "FBCP"
+		const unsigned int CHECKPOINT_VERSION = 2;
+		// Magic, version and then the size of the whole file
+		const unsigned int CHECKPOINT_HEADER_SIZE = 12;
+	}
+
+	GameState::GameState(GameDataRef data) : _data(data), _pipeBatch(data->atlas), _landBatch(data->atlas), _birdBatch(data->atlas), _birdPoints(sf::Points)
+	{
+		MEMORY_TAG(Simulation);
+
 		m_pAIController = new AIController();
 		m_pAIController->setGameState(this);
 	}
@@ -22,6 +40,58 @@ namespace Sonar
 	{
 		if (!_init)
 			return;
+		_init = false;
+
+		// Closing part way through keeps the episode to carry on with, rather than scoring it as it stands
+		bool finished = GameStates::eGameOver == _gameState;
+
+#if TRACING
+		TraceRecorder::Complete("Episode", _episodeStart, std::chrono::steady_clock::now(), "ticks", _tick);
+#endif
+
+#if REPLAY_RECORDING && !REPLAY
+		// Saved before the controller goes, as that can move on to the next generation
+		if (!birds.empty())
+		{
+			// The index only ever shows the last file saved for a generation, so the part of a
+			// resumed stage flown before the restart is kept on disk but isn't browsed to. A stage
+			// carrying on from the last starts part way through too, but has nothing before it
+			const ReplayRecording::Keyframe *first = _recording.GetFirstKeyframe();
+			unsigned int startTick = first != nullptr && first->tick > m_pAIController->GetStageStartTick() ? first->tick : 0;
+			std::string filePath = AIController::GetReplayFilePath(_recording.GetGeneration(), _recording.GetStage(), startTick);
+
+			_recording.SetTickCount(_tick);
+
+			if (this->_data->writer)
+			{
+				// Indexed behind the file, so the index never names a replay before it's on disk
+				std::vector<char> data;
+				_recording.Serialise(data);
+				this->_data->writer->Write(filePath, data);
+				this->_data->writer->Append(AIController::GetReplayIndexFilePath(), ReplayLibrary::GetIndexLine(_recording.GetGeneration(), _recording.GetStage(), _tick, filePath),
+					ReplayLibrary::GetIndexHeader());
+			}
+			else if (_recording.Save(filePath))
+				ReplayLibrary::AddToIndex(AIController::GetReplayIndexFilePath(), _recording.GetGeneration(), _recording.GetStage(), _tick, filePath);
+		}
+#endif
+
+#if !REPLAY
+		if (finished && !_trainingStopped)
+			m_pAIController->EndEpisode();
+#endif
+
+#if CHECKPOINTING && !REPLAY
+		// A controller that couldn't load has nothing of its own to save, and the checkpoint may still be wanted
+		if (this->_data->writer && !_trainingStopped)
+		{
+			// A finished episode's scores are in the generation's file, so there's nothing to resume
+			if (finished)
+				this->_data->writer->Remove(_checkpointFilePath);
+			else
+				SaveCheckpoint();
+		}
+#endif
 
 		delete m_pAIController;
 
@@ -36,26 +106,19 @@ namespace Sonar
 
 	void GameState::Init()
 	{
-		_init = true;
-
-		if (!_hitSoundBuffer.loadFromFile(HIT_SOUND_FILEPATH))
-		{
-			std::cout << "Error Loading Hit Sound Effect" << std::endl;
-		}
+		MEMORY_TAG(Simulation);
 
-		if (!_wingSoundBuffer.loadFromFile(WING_SOUND_FILEPATH))
-		{
-			std::cout << "Error Loading Wing Sound Effect" << std::endl;
-		}
+		_init = true;
+		_episodeStart = std::chrono::steady_clock::now();
 
-		if (!_pointSoundBuffer.loadFromFile(POINT_SOUND_FILEPATH))
-		{
-			std::cout << "Error Loading Point Sound Effect" << std::endl;
-		}
+		// Only the first generation actually loads anything, the rest hit the cache
+		this->_data->assets.LoadSound("Hit Sound", HIT_SOUND_FILEPATH);
+		this->_data->assets.LoadSound("Wing Sound", WING_SOUND_FILEPATH);
+		this->_data->assets.LoadSound("Point Sound", POINT_SOUND_FILEPATH);
 
-		_hitSound.setBuffer(_hitSoundBuffer);
-		_wingSound.setBuffer(_wingSoundBuffer);
-		_pointSound.setBuffer(_pointSoundBuffer);
+		_hitSound.setBuffer(this->_data->assets.GetSound("Hit Sound"));
+		_wingSound.setBuffer(this->_data->assets.GetSound("Wing Sound"));
+		_pointSound.setBuffer(this->_data->assets.GetSound("Point Sound"));
 
 		this->_data->assets.LoadTexture("Game Background", GAME_BACKGROUND_FILEPATH);
 		this->_data->assets.LoadTexture("Pipe Up", PIPE_UP_FILEPATH);
@@ -68,6 +131,19 @@ namespace Sonar
 		this->_data->assets.LoadTexture("Scoring Pipe", SCORING_PIPE_FILEPATH);
 		this->_data->assets.LoadFont("Flappy Font", FLAPPY_FONT_FILEPATH);
 
+#if REPLAY
+		LoadReplay();
+#endif
+
+		// Build the course once, every generation after that reuses it
+		if (!this->_data->course)
+			this->_data->course = std::make_shared<const Course>(COURSE_SEED, this->_data->assets.GetTexture("Land").getSize().y);
+
+#if BATCHED_RENDERING
+		if (!this->_data->atlas.IsBuilt())
+			this->_data->atlas.Build(this->_data->assets, { "Pipe Up", "Pipe Down", "Land", "Bird Frame 1", "Bird Frame 2", "Bird Frame 3", "Bird Frame 4" });
+#endif
+
 		pipe = new Pipe(_data);
 		land = new Land(_data);
 		//bird = new Bird(_data);
@@ -77,28 +153,134 @@ namespace Sonar
 		_background.setTexture(this->_data->assets.GetTexture("Game Background"));
 
 		_score = 0;
+		_shownScore = 0;
 		hud->UpdateScore(_score);
 
-		m_pAIController->Init();
+		_pipeSpawnTime = 0;
+		_gameOverTime = 0;
+		_tick = 0;
+		_simulatedTime = 0;
+
+#if REPLAY
+		// Only the birds that were recorded, and no networks to go with them
+		const std::vector<int> &chromosomes = this->_data->replay->GetBirdIds();
+		_replayDecision = 0;
+#else
+		// Closing the window rather than exiting here, so shutdown still flushes everything queued to disk
+		if (!m_pAIController->Init())
+		{
+			_trainingStopped = true;
+			this->_data->window.close();
+		}
+		const std::vector<int> &chromosomes = m_pAIController->GetActiveChromosomes();
+#endif
+
+		long long liveBytes = AllocationCounter::GetTotalStats().liveBytes;
+
+		for (int chromosome : chromosomes)
+			birds.push_back(new Bird(_data, chromosome));
+
+		_birdFootprint = birds.empty() ? 0 : (AllocationCounter::GetTotalStats().liveBytes - liveBytes) / (long long)birds.size();
 
-		for (int i = 0; i < BIRD_COUNT; i++)
-			birds.push_back(new Bird(_data, i));
+		_livingBirds = birds;
+		_fallenBirds.reserve(birds.size());
+
+#if !REPLAY
+		// Rather than flying the start of the course again to get back to where they were
+		if (ContinueStage())
+			m_pAIController->SetStageStartTick(_tick);
+		this->_data->stageEnd.reserve(GetStateCapacity());
+#endif
+		_snapshots.Reserve(pipe->GetSpriteCapacity(), land->GetSprites().size(), birds.size());
+
+		// Snapshots only carry positions, rotations and frames, the rest comes from here
+		_pipeLayer.AddFrame(pipe->GetKindTexture(PIPE_KIND_UP));
+		_pipeLayer.AddFrame(pipe->GetKindTexture(PIPE_KIND_DOWN));
+		_landLayer.AddFrame(*land->GetSprites().front().getTexture());
+		if (!birds.empty())
+		{
+			for (const sf::Texture *frame : birds.front()->GetFrames())
+				_birdLayer.AddFrame(*frame);
+			_birdLayer.SetOrigin(birds.front()->GetSprite().getOrigin());
+		}
+
+#if REPLAY_RECORDING && !REPLAY
+		unsigned int tickLimit = m_pAIController->GetEpisodeTickLimit();
+		_recording.Begin(this->_data->course->GetSeed(), this->_data->course->GetLength(), m_pAIController->GetCurrentGeneration(), m_pAIController->GetRacingStage(),
+			chromosomes, tickLimit, EPISODE_SCORE_LIMIT);
+		_recording.Reserve(tickLimit, GetStateCapacity());
+#endif
 
 		_gameState = GameStates::eReady;
+
+#if REPLAY
+		// A recording of a resumed episode starts where it was resumed
+		const ReplayRecording::Keyframe *first = this->_data->replay->GetFirstKeyframe();
+		if (first != nullptr && first->tick > 0)
+		{
+			StateReader in = this->_data->replay->ReadKeyframe(*first);
+			LoadState(in);
+			_replayDecision = first->decision;
+		}
+#endif
+
+#if CHECKPOINTING && !REPLAY
+		if (this->_data->writer && !_trainingStopped)
+		{
+			_checkpointFilePath = AIController::GetCheckpointFilePath();
+
+			// The controller's part is a few values per bird
+			unsigned int checkpointBytes = CHECKPOINT_HEADER_SIZE + GetStateCapacity() + 64 + (unsigned int)birds.size() * 16;
+			_checkpoint.reserve(checkpointBytes);
+			this->_data->writer->Reserve(_checkpointFilePath, checkpointBytes);
+
+			ResumeFromCheckpoint();
+		}
+#endif
+
+		// So there's something to draw before the first step
+		PublishSnapshot(0);
 	}
 
 	void GameState::HandleInput()
 	{
+		PROFILE_SCOPE("HandleInput");
+		MEMORY_TAG(Simulation);
+
 #if PLAY_WITH_AI
 		if (GameStates::eGameOver != _gameState)
 		{
 			_gameState = GameStates::ePlaying;
 
-			for (Bird* bird : birds)
+#if REPLAY_RECORDING && !REPLAY
+			// Always one to start from, even when resuming part way through
+			if (_tick % REPLAY_KEYFRAME_TICKS == 0 || _recording.GetFirstKeyframe() == nullptr)
 			{
+				StateWriter out = _recording.BeginKeyframe(_tick);
+				SaveState(out);
+				_recording.EndKeyframe();
+			}
+#endif
+
+#if CHECKPOINTING && !REPLAY
+			// Between ticks, where the world is whole, and the writing happens elsewhere
+			if (this->_data->writer && _tick > 0 && _tick % CHECKPOINT_TICKS == 0)
+				SaveCheckpoint();
+#endif
+
+			for (Bird* bird : _livingBirds)
+			{
+#if REPLAY
+				bool flap = this->_data->replay->GetDecision(_replayDecision++);
+#else
 				m_pAIController->update(bird);
+				bool flap = m_pAIController->shouldFlap();
+#if REPLAY_RECORDING
+				_recording.AppendDecision(flap);
+#endif
+#endif
 
-				if (m_pAIController->shouldFlap())
+				if (flap)
 				{
 					bird->Tap();
 #if !SILENT
@@ -108,76 +290,125 @@ namespace Sonar
 			}
 		}
 #endif
-		sf::Event event;
-		while (this->_data->window.pollEvent(event))
+	}
+
+	void GameState::HandleEvent(const sf::Event &event)
+	{
+		// Every use of it can be compiled out
+		(void)event;
+
+#if REPLAY
+		if (sf::Event::KeyPressed == event.type && GameStates::eReady != _gameState)
 		{
-			if (sf::Event::Closed == event.type)
+			if (sf::Keyboard::Right == event.key.code)
+				Seek(_tick + REPLAY_SEEK_TICKS);
+			else if (sf::Keyboard::Left == event.key.code)
+				Seek(_tick - std::min(_tick, (unsigned int)REPLAY_SEEK_TICKS));
+			else if (sf::Keyboard::Home == event.key.code)
+				Seek(0);
+			else if (sf::Keyboard::LBracket == event.key.code || sf::Keyboard::RBracket == event.key.code)
 			{
-				this->_data->window.close();
+				int step = event.key.shift ? REPLAY_BROWSE_STEP : 1;
+				Browse(sf::Keyboard::LBracket == event.key.code ? -step : step);
 			}
+		}
+#endif
+
+#if LOD_RENDERING
+		if (sf::Event::KeyPressed == event.type && (sf::Keyboard::Up == event.key.code || sf::Keyboard::Down == event.key.code))
+		{
+			if (sf::Keyboard::Up == event.key.code)
+				this->_data->renderTopK += TRAINING_RENDER_TOP_K_STEP;
+			else
+				this->_data->renderTopK -= std::min(this->_data->renderTopK, (unsigned int)TRAINING_RENDER_TOP_K_STEP);
 
-			if (this->_data->input.IsSpriteClicked(this->_background, sf::Mouse::Left, this->_data->window))
+			std::cout << "Drawing the top " << this->_data->renderTopK << " birds" << std::endl;
+		}
+#endif
+
+#if !PLAY_WITH_AI && !REPLAY
+		// Only for a human player, a flap the networks or the recording didn't make would put the replay out of step
+		if (sf::Event::MouseButtonPressed == event.type && !birds.empty() && this->_data->input.IsSpriteClicked(this->_background, sf::Mouse::Left, this->_data->window))
+		{
+			if (GameStates::eGameOver != _gameState)
 			{
-				if (GameStates::eGameOver != _gameState)
-				{
-					_gameState = GameStates::ePlaying;
-					birds[0]->Tap();
+				_gameState = GameStates::ePlaying;
+				birds[0]->Tap();
 
 #if !SILENT
-					_wingSound.play();
+				_wingSound.play();
 #endif
-				}
 			}
 		}
+#endif
 	}
 
 	void GameState::Update(float dt)
 	{
+		PROFILE_SCOPE("Update");
+		MEMORY_TAG(Simulation);
+
+		_simulatedTime += dt;
+
+#if REPLAY_RECORDING && !REPLAY
+		_recording.SetStep(dt);
+#endif
+
 		if (GameStates::eGameOver != _gameState)
 		{
-			for (Bird* bird : birds)
+			for (Bird* bird : _livingBirds)
 				bird->Animate(dt);
 			land->MoveLand(dt);
 		}
 
 		if (GameStates::ePlaying == _gameState)
 		{
+			_tick++;
+			METRIC_ADD(Ticks, 1);
+			METRIC_SET(AliveBirds, (double)_livingBirds.size());
+
 			pipe->MovePipes(dt);
 
-			if (clock.getElapsedTime().asSeconds() > PIPE_SPAWN_FREQUENCY)
+			_pipeSpawnTime += dt;
+
+			if (_pipeSpawnTime > PIPE_SPAWN_FREQUENCY)
 			{
-				pipe->RandomisePipeOffset();
+				pipe->NextPipeOffset();
 
 				pipe->SpawnInvisiblePipe();
 				pipe->SpawnBottomPipe();
 				pipe->SpawnTopPipe();
 				pipe->SpawnScoringPipe();
 
-				clock.restart();
+				_pipeSpawnTime = 0;
 			}
 
-			std::vector<sf::Sprite> landSprites = land->GetSprites();
+			// Dead birds only scroll away with the pipes, and stop being drawn once off screen
+			for (Bird* bird : _fallenBirds)
+				bird->Update(dt);
+
+			_fallenBirds.erase(std::remove_if(_fallenBirds.begin(), _fallenBirds.end(), IsOffScreen), _fallenBirds.end());
+
+			// References, not copies, so a tick doesn't allocate
+			const std::vector<sf::Sprite>& landSprites = land->GetSprites();
+			const std::vector<sf::Sprite>& pipeSprites = pipe->GetSprites();
 
-			// Assume all birds are dead
-			_gameState = GameStates::eGameOver;
 			bool scored = false;
 
-			for (Bird* bird : birds)
+			for (unsigned int index = 0; index < _livingBirds.size();)
 			{
-				bird->Update(dt);
-
-				if (bird->IsDead())
-					continue;
+				Bird* bird = _livingBirds[index];
 
-				// A bird is not dead, so we keep playing
-				_gameState = GameStates::ePlaying;
+				bird->Update(dt);
 
 				for (unsigned int i = 0; i < landSprites.size(); i++)
 				{
 					if (collision.CheckSpriteCollision(bird->GetSprite(), 0.7f, landSprites.at(i), 1.0f, false))
 					{
 						bird->Die(_score);
+#if !REPLAY
 						m_pAIController->BirdDied(bird, _score);
+#endif
 
 #if !SILENT
 						_hitSound.play();
@@ -187,16 +418,19 @@ namespace Sonar
 				}
 
 				if (bird->IsDead())
+				{
+					RemoveLivingBird(index);
 					continue;
-
-				std::vector<sf::Sprite> pipeSprites = pipe->GetSprites();
+				}
 
 				for (unsigned int i = 0; i < pipeSprites.size(); i++)
 				{
 					if (collision.CheckSpriteCollision(bird->GetSprite(), 0.625f, pipeSprites.at(i), 1.0f, true))
 					{
 						bird->Die(_score);
+#if !REPLAY
 						m_pAIController->BirdDied(bird, _score);
+#endif
 
 #if !SILENT
 						_hitSound.play();
@@ -206,60 +440,584 @@ namespace Sonar
 				}
 
 				if (bird->IsDead())
+				{
+					RemoveLivingBird(index);
 					continue;
+				}
 
-				if (GameStates::ePlaying == _gameState)
-				{
-					std::vector<sf::Sprite>& scoringSprites = pipe->GetScoringSprites();
+				std::vector<sf::Sprite>& scoringSprites = pipe->GetScoringSprites();
 
-					for (unsigned int i = 0; i < scoringSprites.size(); i++)
+				for (unsigned int i = 0; i < scoringSprites.size(); i++)
+				{
+					if (collision.CheckSpriteCollision(bird->GetSprite(), 0.625f, scoringSprites.at(i), 1.0f, false))
 					{
-						if (collision.CheckSpriteCollision(bird->GetSprite(), 0.625f, scoringSprites.at(i), 1.0f, false))
-						{
-							scored = true;
-							scoringSprites.erase(scoringSprites.begin() + i);
-						}
+						scored = true;
+						scoringSprites.erase(scoringSprites.begin() + i);
 					}
 				}
+
+				index++;
 			}
 
 			if (scored)
 			{
 				_score++;
-				hud->UpdateScore(_score);
 #if !SILENT
 				_pointSound.play();
 #endif
 			}
 
+			// Retire any survivors so one strong bird can't hold up the whole generation
+			if (!_livingBirds.empty() && EpisodeLimitReached())
+			{
+#if !REPLAY
+				if (m_pAIController->GetRacingStage() < RACING_STAGE_COUNT - 1)
+					SaveStageEnd();
+#endif
+
+				for (Bird* bird : _livingBirds)
+				{
+					bird->Die(_score);
+#if !REPLAY
+					m_pAIController->BirdRetired(bird, _score);
+#endif
+				}
+
+				_fallenBirds.insert(_fallenBirds.end(), _livingBirds.begin(), _livingBirds.end());
+				_livingBirds.clear();
+			}
+
+			if (_livingBirds.empty())
+				_gameState = GameStates::eGameOver;
+
 			// If all the birds died, reset
 			if (_gameState == GameStates::eGameOver)
-				clock.restart();
+				_gameOverTime = 0;
 		}
 
 		if (GameStates::eGameOver == _gameState)
 		{
-			flash->Show(dt);
+			// Simulated time, so fast forwarding doesn't sit on the flash for real seconds
+			_gameOverTime += dt;
 
-			if (clock.getElapsedTime().asSeconds() > TIME_BEFORE_GAME_OVER_APPEARS)
+			if (_gameOverTime > TIME_BEFORE_GAME_OVER_APPEARS)
 			{
 				// TODO record data
 				this->_data->machine.AddState(StateRef(new GameState(_data)), true);
 			}
 		}
+
+		PublishSnapshot(dt);
+	}
+
+	void GameState::RemoveLivingBird(unsigned int index)
+	{
+		_fallenBirds.push_back(_livingBirds[index]);
+
+		// Order doesn't matter, so fill the gap with the last bird rather than shifting them all down
+		_livingBirds[index] = _livingBirds.back();
+		_livingBirds.pop_back();
+	}
+
+	bool GameState::EpisodeLimitReached()
+	{
+#if REPLAY
+		// Whatever limits the recording was made under, so birds retire on the same tick
+		unsigned int tickLimit = this->_data->replay->GetTickLimit();
+		int scoreLimit = this->_data->replay->GetScoreLimit();
+#else
+		unsigned int tickLimit = m_pAIController->GetEpisodeTickLimit();
+		int scoreLimit = EPISODE_SCORE_LIMIT;
+#endif
+
+		if (tickLimit > 0 && _tick >= tickLimit)
+			return true;
+
+		if (scoreLimit > 0 && _score >= scoreLimit)
+			return true;
+
+		return false;
+	}
+
+#if !REPLAY
+	void GameState::SaveStageEnd()
+	{
+		std::vector<char> &stageEnd = this->_data->stageEnd;
+		stageEnd.clear();
+		StateWriter out(stageEnd);
+
+		out.Write(m_pAIController->GetCurrentGeneration());
+		out.Write(m_pAIController->GetRacingStage());
+
+		// Each bird's state is sized, so the ones that weren't promoted can be skipped
+		out.Write((unsigned int)_livingBirds.size());
+		for (Bird* bird : _livingBirds)
+		{
+			out.Write(bird->GetID());
+
+			size_t sizeAt = stageEnd.size();
+			out.Write(0u);
+			bird->SaveState(out);
+
+			unsigned int size = (unsigned int)(stageEnd.size() - sizeAt - sizeof(size));
+			std::memcpy(stageEnd.data() + sizeAt, &size, sizeof(size));
+		}
+
+		out.Write(_tick);
+		out.Write(_score);
+		out.Write(_pipeSpawnTime);
+		out.Write(_simulatedTime);
+
+		pipe->SaveState(out);
+		land->SaveState(out);
+	}
+
+	bool GameState::ContinueStage()
+	{
+		std::vector<char> &stageEnd = this->_data->stageEnd;
+		int stage = m_pAIController->GetRacingStage();
+
+		if (stageEnd.empty() || stage == 0 || birds.empty())
+			return false;
+
+		StateReader in(stageEnd.data(), stageEnd.size());
+		if (in.Read<int>() != m_pAIController->GetCurrentGeneration() || in.Read<int>() != stage - 1)
+			return false;
+
+		size_t birdsAt = stageEnd.size() - in.GetRemaining();
+		unsigned int count = in.Read<unsigned int>();
+
+		// Every bird here has to have been flying when the stage ended, a restart in between leaves them to start over
+		unsigned int found = 0;
+		for (unsigned int i = 0; i < count && in.IsValid(); i++)
+		{
+			if (FindBird(in.Read<int>()) != nullptr)
+				found++;
+			in.Skip(in.Read<unsigned int>());
+		}
+
+		if (!in.IsValid() || found != birds.size())
+			return false;
+
+		_tick = in.Read<unsigned int>();
+		_score = in.Read<int>();
+		_pipeSpawnTime = in.Read<float>();
+		_simulatedTime = in.Read<float>();
+
+		pipe->LoadState(in);
+		land->LoadState(in);
+
+		StateReader birdsIn(stageEnd.data() + birdsAt, stageEnd.size() - birdsAt);
+		count = birdsIn.Read<unsigned int>();
+		for (unsigned int i = 0; i < count; i++)
+		{
+			Bird* bird = FindBird(birdsIn.Read<int>());
+			unsigned int size = birdsIn.Read<unsigned int>();
+
+			if (bird != nullptr)
+			{
+				StateReader birdIn(stageEnd.data() + stageEnd.size() - birdsIn.GetRemaining(), size);
+				bird->LoadState(birdIn);
+			}
+
+			birdsIn.Skip(size);
+		}
+
+		// Only good for the stage straight after it
+		stageEnd.clear();
+
+		return true;
+	}
+
+	Bird* GameState::FindBird(int id)
+	{
+		for (Bird* bird : birds)
+			if (bird->GetID() == id)
+				return bird;
+
+		return nullptr;
+	}
+#endif
+
+#if REPLAY
+	bool GameState::LoadReplay()
+	{
+		if (!this->_data->replays)
+		{
+			std::shared_ptr<ReplayLibrary> replays = std::make_shared<ReplayLibrary>();
+			this->_data->replays = replays;
+
+			if (replays->Open(AIController::GetReplayIndexFilePath(), AIController::GetGenomeHistoryFilePath()))
+			{
+				this->_data->replayEntry = replays->Find(REPLAY_GENERATION);
+				this->_data->replay = replays->Get(this->_data->replayEntry);
+				replays->Prefetch(this->_data->replayEntry);
+			}
+
+			// Leave an empty recording in its place, so the episode ends straight away rather than crashing
+			if (!this->_data->replay)
+			{
+				std::cout << "Error Finding A Replay To Play" << std::endl;
+				this->_data->replay = std::make_shared<const ReplayRecording>();
+				this->_data->window.close();
+				return false;
+			}
+
+			PrintReplay();
+		}
+
+		if (this->_data->replay->GetBirdIds().empty())
+			return false;
+
+		// Fly the course it was recorded on, whatever this build would make
+		const ReplayRecording &replay = *this->_data->replay;
+		if (!this->_data->course || this->_data->course->GetSeed() != replay.GetCourseSeed() || this->_data->course->GetLength() != replay.GetCourseLength())
+			this->_data->course = std::make_shared<const Course>(replay.GetCourseSeed(), this->_data->assets.GetTexture("Land").getSize().y, replay.GetCourseLength());
+
+		return true;
+	}
+
+	void GameState::Browse(int step)
+	{
+		ReplayLibrary &replays = *this->_data->replays;
+
+		// Going past the end picks up whatever a running trainer has saved since
+		int entry = (int)this->_data->replayEntry + step;
+		if (entry >= (int)replays.GetCount())
+			replays.Open(AIController::GetReplayIndexFilePath(), AIController::GetGenomeHistoryFilePath());
+
+		entry = std::max(0, std::min(entry, (int)replays.GetCount() - 1));
+		if (entry == (int)this->_data->replayEntry)
+			return;
+
+		// Usually already loaded by the prefetch, so this doesn't hold up the frame
+		std::shared_ptr<const ReplayRecording> replay = replays.Get(entry);
+		if (!replay)
+			return;
+
+		this->_data->replay = replay;
+		this->_data->replayEntry = entry;
+		replays.Prefetch(entry);
+
+		PrintReplay();
+
+		// A fresh episode, as this one's birds and course belong to the old recording
+		this->_data->machine.AddState(StateRef(new GameState(_data)), true);
+	}
+
+	void GameState::PrintReplay()
+	{
+		const ReplayRecording &replay = *this->_data->replay;
+
+		std::cout << "Replaying generation " << replay.GetGeneration() << " stage " << replay.GetStage()
+			<< ", " << replay.GetBirdIds().size() << " birds for " << replay.GetTickCount() << " ticks" << std::endl;
+
+		// How they went on to score, once the generation's finished and recorded, even if its file has been pruned
+		std::shared_ptr<const Generation> generation = this->_data->replays->RebuildGeneration(replay.GetGeneration());
+		if (!generation)
+			return;
+
+		int best = -1;
+		for (int id : replay.GetBirdIds())
+			if (id >= 0 && id < BIRD_COUNT && generation->chromosomes[id].scored && (best < 0 || generation->chromosomes[id].score > generation->chromosomes[best].score))
+				best = id;
+
+		if (best >= 0)
+			std::cout << "Best of them is chromosome " << best << ", scoring " << generation->chromosomes[best].score << std::endl;
+	}
+
+	void GameState::Seek(unsigned int tick)
+	{
+		const ReplayRecording &replay = *this->_data->replay;
+
+		tick = std::min(tick, replay.GetTickCount());
+
+		// Nothing was recorded before a resumed episode's first keyframe
+		const ReplayRecording::Keyframe *keyframe = replay.FindKeyframe(tick);
+		if (keyframe == nullptr)
+			keyframe = replay.GetFirstKeyframe();
+		if (keyframe == nullptr)
+			return;
+
+		StateReader in = replay.ReadKeyframe(*keyframe);
+		LoadState(in);
+		_replayDecision = keyframe->decision;
+
+		// Simulate the rest of the way from the keyframe, with no networks it's quick
+		while (_tick < tick && GameStates::ePlaying == _gameState)
+		{
+			HandleInput();
+			Update(replay.GetStep());
+		}
+
+		std::cout << "Replay at tick " << _tick << " of " << replay.GetTickCount() << std::endl;
+	}
+#endif
+
+#if CHECKPOINTING && !REPLAY
+	void GameState::SaveCheckpoint()
+	{
+		_checkpoint.clear();
+		StateWriter out(_checkpoint);
+
+		out.Write(CHECKPOINT_MAGIC);
+		out.Write(CHECKPOINT_VERSION);
+		out.Write(0u);
+
+		m_pAIController->SaveCheckpoint(out);
+		SaveState(out);
+
+		// So a damaged file is caught before any of it is used
+		unsigned int size = (unsigned int)_checkpoint.size();
+		std::memcpy(_checkpoint.data() + CHECKPOINT_HEADER_SIZE - sizeof(size), &size, sizeof(size));
+
+		this->_data->writer->Write(_checkpointFilePath, _checkpoint);
+	}
+
+	bool GameState::ResumeFromCheckpoint()
+	{
+		std::ifstream f(_checkpointFilePath, std::ios::binary);
+		if (!f.good())
+			return false;
+
+		std::vector<char> buffer((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+		StateReader in(buffer.data(), buffer.size());
+
+		if (in.Read<unsigned int>() != CHECKPOINT_MAGIC || in.Read<unsigned int>() != CHECKPOINT_VERSION || in.Read<unsigned int>() != buffer.size())
+		{
+			std::cout << "Error Loading Checkpoint " << _checkpointFilePath << ", starting the episode over" << std::endl;
+			return false;
+		}
+
+		// One left by an episode that finished since is for birds that are already scored
+		if (!m_pAIController->LoadCheckpoint(in))
+			return false;
+
+		LoadState(in);
+
+		std::cout << "Resuming generation " << m_pAIController->GetCurrentGeneration() << " stage " << m_pAIController->GetRacingStage()
+			<< " at tick " << _tick << ", " << _livingBirds.size() << " of " << birds.size() << " birds still flying" << std::endl;
+
+		return true;
+	}
+#endif
+
+	unsigned int GameState::GetStateCapacity() const
+	{
+		return 128 + (unsigned int)birds.size() * 64 + pipe->GetSpriteCapacity() * 32;
+	}
+
+	void GameState::SaveState(StateWriter &out) const
+	{
+		out.Write(_tick);
+		out.Write(_score);
+		out.Write(_gameState);
+		out.Write(_pipeSpawnTime);
+		out.Write(_gameOverTime);
+		out.Write(_simulatedTime);
+
+		for (const Bird* bird : birds)
+			bird->SaveState(out);
+
+		SaveBirdList(out, _livingBirds);
+		SaveBirdList(out, _fallenBirds);
+
+		pipe->SaveState(out);
+		land->SaveState(out);
+	}
+
+	void GameState::LoadState(StateReader &in)
+	{
+		_tick = in.Read<unsigned int>();
+		_score = in.Read<int>();
+		_gameState = in.Read<int>();
+		_pipeSpawnTime = in.Read<float>();
+		_gameOverTime = in.Read<float>();
+		_simulatedTime = in.Read<float>();
+
+		for (Bird* bird : birds)
+			bird->LoadState(in);
+
+		LoadBirdList(in, _livingBirds);
+		LoadBirdList(in, _fallenBirds);
+
+		pipe->LoadState(in);
+		land->LoadState(in);
+	}
+
+	void GameState::SaveBirdList(StateWriter &out, const std::vector<Bird*> &list) const
+	{
+		// By index into birds, which never changes order
+		out.Write((unsigned int)list.size());
+		for (Bird* bird : list)
+			out.Write((unsigned int)(std::find(birds.begin(), birds.end(), bird) - birds.begin()));
+	}
+
+	void GameState::LoadBirdList(StateReader &in, std::vector<Bird*> &list)
+	{
+		list.clear();
+
+		unsigned int count = in.Read<unsigned int>();
+		for (unsigned int i = 0; i < count && in.IsValid(); i++)
+		{
+			unsigned int index = in.Read<unsigned int>();
+			if (index < birds.size())
+				list.push_back(birds[index]);
+		}
+	}
+
+	void GameState::PublishSnapshot(float dt)
+	{
+		PROFILE_SCOPE("PublishSnapshot");
+
+		WorldSnapshot &snapshot = _snapshots.BeginWrite();
+
+		snapshot.Clear();
+		snapshot.simulatedTime = _simulatedTime;
+		snapshot.step = dt;
+		snapshot.publishedAt = this->_data->clock.getElapsedTime().asSeconds();
+		snapshot.score = _score;
+		snapshot.gameOver = GameStates::eGameOver == _gameState;
+
+		const std::vector<sf::Sprite> &pipeSprites = pipe->GetSprites();
+		const std::vector<unsigned int> &pipeIds = pipe->GetSpriteIds();
+		for (unsigned int i = 0; i < pipeSprites.size(); i++)
+		{
+			// Invisible pipes are only there to collide with
+			int kind = pipe->GetSpriteKind(i);
+			if (PIPE_KIND_INVISIBLE != kind)
+				WorldSnapshot::Capture(snapshot.pipes, pipeIds[i], pipeSprites[i], kind);
+		}
+
+		const std::vector<sf::Sprite> &landSprites = land->GetSprites();
+		for (unsigned int i = 0; i < landSprites.size(); i++)
+			WorldSnapshot::Capture(snapshot.land, i, landSprites[i]);
+
+		// Only the birds still on screen, fallen ones are dropped from their list as they leave it
+		for (Bird* bird : _livingBirds)
+			WorldSnapshot::Capture(snapshot.livingBirds, bird->GetID(), bird->GetSprite(), bird->GetFrame());
+		for (Bird* bird : _fallenBirds)
+			WorldSnapshot::Capture(snapshot.fallenBirds, bird->GetID(), bird->GetSprite(), bird->GetFrame());
+
+		// Deaths swap birds out of order, and matching snapshots up needs them in id order
+		WorldSnapshot::SortById(snapshot.livingBirds);
+		WorldSnapshot::SortById(snapshot.fallenBirds);
+
+		_snapshots.Publish();
+	}
+
+	bool GameState::IsOffScreen(const Bird *bird)
+	{
+		sf::FloatRect bounds = bird->GetSprite().getGlobalBounds();
+		return bounds.left + bounds.width < 0;
+	}
+
+	void GameState::InterpolateLayer(const std::vector<SpriteSnapshot> &previous, const std::vector<SpriteSnapshot> &current, float alpha, const SpriteLayer &layer, std::vector<sf::Sprite> &drawn)
+	{
+		drawn.clear();
+
+		// Both layers are in id order, so one cursor finds each sprite's previous self
+		std::vector<SpriteSnapshot>::const_iterator from = previous.begin();
+
+		for (const SpriteSnapshot &to : current)
+		{
+			sf::Vector2f position = to.position;
+			float rotation = to.rotation;
+
+			while (from != previous.end() && from->id < to.id)
+				from++;
+
+			// New sprites just appear where they are
+			if (from != previous.end() && from->id == to.id && alpha < 1.0f)
+			{
+				sf::Vector2f move = to.position - from->position;
+
+				// Rotations come back as 0 to 360, so turn whichever way is shorter
+				float turn = to.rotation - from->rotation;
+				if (turn > 180.0f)
+					turn -= 360.0f;
+				else if (turn < -180.0f)
+					turn += 360.0f;
+
+				// Land wrapping back round is a teleport, not something to slide across the screen
+				if (std::abs(move.x) <= MAX_INTERPOLATION_DISTANCE && std::abs(move.y) <= MAX_INTERPOLATION_DISTANCE)
+				{
+					position = from->position + move * alpha;
+					rotation = from->rotation + turn * alpha;
+				}
+			}
+
+			drawn.push_back(layer.Build(to.frame, position, rotation));
+		}
 	}
 
 	void GameState::Draw(float dt)
 	{
+		PROFILE_SCOPE("Draw");
+
+		_snapshots.Consume();
+
+		const WorldSnapshot &previous = _snapshots.GetPrevious();
+		const WorldSnapshot &current = _snapshots.GetCurrent();
+
+		// How far to draw between the previous and current snapshot
+		float alpha = dt;
+
+#if THREADED_SIMULATION
+		// Nothing to go on but when they turned up, so trail a snapshot behind and
+		// reach the current one about as long after it arrived as it took to come
+		float interval = current.publishedAt - previous.publishedAt;
+		float now = this->_data->clock.getElapsedTime().asSeconds();
+		alpha = interval > 0.0f ? (now - current.publishedAt) / interval : 1.0f;
+#endif
+
+		// Fast forwarding skips whole steps between frames, so there's nothing sensible to blend
+		float gap = current.simulatedTime - previous.simulatedTime;
+		if (gap <= 0.0f || gap > current.step * 1.5f)
+			alpha = 1.0f;
+
+		alpha = std::max(0.0f, std::min(alpha, 1.0f));
+
+		InterpolateLayer(previous.pipes, current.pipes, alpha, _pipeLayer, _drawnPipes);
+		InterpolateLayer(previous.land, current.land, alpha, _landLayer, _drawnLand);
+		InterpolateLayer(previous.livingBirds, current.livingBirds, alpha, _birdLayer, _drawnLivingBirds);
+		InterpolateLayer(previous.fallenBirds, current.fallenBirds, alpha, _birdLayer, _drawnFallenBirds);
+
+		float frameTime = _frameClock.restart().asSeconds();
+
+		if (current.score != _shownScore)
+		{
+			_shownScore = current.score;
+			hud->UpdateScore(_shownScore);
+		}
+
+		if (current.gameOver)
+			flash->Show(frameTime);
+
 		this->_data->window.clear(sf::Color::Red);
 
 		this->_data->window.draw(this->_background);
 
-		pipe->DrawPipes();
-		land->DrawLand();
+#if BATCHED_RENDERING
+		_pipeBatch.Clear();
+		for (const sf::Sprite& sprite : _drawnPipes)
+			_pipeBatch.Add(sprite);
 
-		for (Bird* bird : birds)
-			bird->Draw();
+		_landBatch.Clear();
+		for (const sf::Sprite& sprite : _drawnLand)
+			_landBatch.Add(sprite);
+
+		_pipeBatch.Draw(this->_data->window);
+		_landBatch.Draw(this->_data->window);
+#else
+		for (const sf::Sprite& sprite : _drawnPipes)
+			this->_data->window.draw(sprite);
+
+		for (const sf::Sprite& sprite : _drawnLand)
+			this->_data->window.draw(sprite);
+#endif
+
+		DrawBirds();
 
 		flash->Draw();
 
@@ -268,5 +1026,52 @@ namespace Sonar
 		this->_data->window.display();
 	}
 
-	
+	void GameState::DrawBirds()
+	{
+		_birdsToDraw.clear();
+		_birdPoints.clear();
+
+#if !LOD_RENDERING
+		// Fallen birds go underneath the ones still flying
+		for (const sf::Sprite& sprite : _drawnFallenBirds)
+			_birdsToDraw.push_back(&sprite);
+#endif
+
+		for (const sf::Sprite& sprite : _drawnLivingBirds)
+			_birdsToDraw.push_back(&sprite);
+
+#if LOD_RENDERING
+		unsigned int topK = std::min(this->_data->renderTopK, (unsigned int)_birdsToDraw.size());
+
+		// Every living bird has survived equally long, so rank them on how close
+		// they are to the middle of the next gap, the ones most likely to keep going
+		float gapCentre = 0;
+		if (topK < _birdsToDraw.size() && Pipe::GetNextGapCentre(_drawnPipes, _birdsToDraw[0]->getPosition().x, gapCentre))
+		{
+			std::nth_element(_birdsToDraw.begin(), _birdsToDraw.begin() + topK, _birdsToDraw.end(), [gapCentre](const sf::Sprite* a, const sf::Sprite* b)
+				{
+					return std::abs(a->getPosition().y - gapCentre) < std::abs(b->getPosition().y - gapCentre);
+				});
+		}
+
+		// Everyone else is just a dot, which is enough to see where the population is
+		for (unsigned int i = topK; i < _birdsToDraw.size(); i++)
+			_birdPoints.append(sf::Vertex(_birdsToDraw[i]->getPosition(), sf::Color::Yellow));
+
+		_birdsToDraw.resize(topK);
+
+		this->_data->window.draw(_birdPoints);
+#endif
+
+#if BATCHED_RENDERING
+		_birdBatch.Clear();
+		for (const sf::Sprite* sprite : _birdsToDraw)
+			_birdBatch.Add(*sprite);
+		_birdBatch.Draw(this->_data->window);
+#else
+		for (const sf::Sprite* sprite : _birdsToDraw)
+			this->_data->window.draw(*sprite);
+#endif
+	}
+
 }
\ No newline at end of file
@@ -2,6 +2,7 @@
 
 #include <SFML/Graphics.hpp>
 #include <SFML/Audio.hpp>
+#include <chrono>
 
 #include "State.hpp"
 #include "Game.hpp"
@@ -11,6 +12,8 @@
 #include "Collision.hpp"
 #include "Flash.hpp"
 #include "HUD.hpp"
+#include "SpriteBatch.hpp"
+#include "WorldSnapshot.hpp"
 
 using namespace Sonar;
 
@@ -26,6 +29,7 @@ namespace Sonar
 		void Init();
 		void CleanUp();
 
+		void HandleEvent(const sf::Event &event);
 		void HandleInput();
 		void Update(float dt);
 		void Draw(float dt);
@@ -33,6 +37,13 @@ namespace Sonar
 		Pipe* GetPipeContainer() { return pipe; };
 		Land* GetLandContainer() { return land; };
 		//Bird* GetBird() { return bird; }
+		unsigned int GetTick() { return _tick; }
+		AIController* GetAIController() { return m_pAIController; }
+		// nullptr when saving should happen there and then
+		BackgroundWriter* GetWriter() { return _data->writer.get(); }
+		unsigned int GetLivingBirdCount() { return (unsigned int)_livingBirds.size(); }
+		// Heap bytes each bird took to create, 0 without ALLOCATION_HOOKS
+		long long GetBirdFootprint() { return _birdFootprint; }
 
 	private:
 		GameDataRef _data;
@@ -43,13 +54,46 @@ namespace Sonar
 		Land *land;
 		//Bird *bird;
 		std::vector<Bird*> birds;
+		// Birds still flying, and dead birds that are still on screen
+		std::vector<Bird*> _livingBirds;
+		std::vector<Bird*> _fallenBirds;
 		Collision collision;
 		Flash *flash;
 		HUD *hud;
 
+		SpriteBatch _pipeBatch;
+		SpriteBatch _landBatch;
+		SpriteBatch _birdBatch;
+
+		// Published by the simulation every step, the renderer only ever draws these
+		SnapshotBuffer _snapshots;
+		float _simulatedTime;
+
+		// Turns the snapshots back into sprites
+		SpriteLayer _pipeLayer;
+		SpriteLayer _landLayer;
+		SpriteLayer _birdLayer;
+
+		// The last two snapshots blended together, kept to avoid reallocating every frame
+		std::vector<sf::Sprite> _drawnPipes;
+		std::vector<sf::Sprite> _drawnLand;
+		std::vector<sf::Sprite> _drawnLivingBirds;
+		std::vector<sf::Sprite> _drawnFallenBirds;
+
+		// Scratch space for picking which birds to draw
+		std::vector<const sf::Sprite*> _birdsToDraw;
+		sf::VertexArray _birdPoints;
+
+		// Render side copies of what the snapshots say, for the HUD and flash
+		sf::Clock _frameClock;
+		int _shownScore;
+
 		bool _init = false;
+		// The controller couldn't load the generation, so this episode flies nobody and nothing of it is kept
+		bool _trainingStopped = false;
 
-		sf::Clock clock;
+		float _pipeSpawnTime;
+		float _gameOverTime;
 
 		int _gameState;
 
@@ -57,10 +101,57 @@ namespace Sonar
 		bool _flashOn;
 
 		int _score;
-
-		sf::SoundBuffer _hitSoundBuffer;
-		sf::SoundBuffer _wingSoundBuffer;
-		sf::SoundBuffer _pointSoundBuffer;
+		unsigned int _tick;
+		std::chrono::steady_clock::time_point _episodeStart;
+		long long _birdFootprint;
+
+#if REPLAY
+		// Index of the next recorded decision to play
+		unsigned long long _replayDecision;
+
+		bool LoadReplay();
+		// Moves step generations through the library, starting a new episode with that one
+		void Browse(int step);
+		void PrintReplay();
+		// Jumps to tick, by way of the keyframe before it
+		void Seek(unsigned int tick);
+#elif REPLAY_RECORDING
+		ReplayRecording _recording;
+#endif
+
+#if CHECKPOINTING && !REPLAY
+		std::string _checkpointFilePath;
+		// Reused every checkpoint, the writer hands back the last one it wrote
+		std::vector<char> _checkpoint;
+
+		void SaveCheckpoint();
+		bool ResumeFromCheckpoint();
+#endif
+
+		void RemoveLivingBird(unsigned int index);
+		bool EpisodeLimitReached();
+
+#if !REPLAY
+		// Every bird still flying at a stage's limit, by id, so the ones promoted can carry on from there
+		void SaveStageEnd();
+		// False, changing nothing, without a stage end from the stage before that all of birds were flying at
+		bool ContinueStage();
+		Bird* FindBird(int id);
+#endif
+
+		// The whole world, for replay keyframes and checkpoints
+		void SaveState(StateWriter &out) const;
+		void LoadState(StateReader &in);
+		void SaveBirdList(StateWriter &out, const std::vector<Bird*> &list) const;
+		void LoadBirdList(StateReader &in, std::vector<Bird*> &list);
+		// Comfortably more than SaveState writes
+		unsigned int GetStateCapacity() const;
+
+		void PublishSnapshot(float dt);
+		static bool IsOffScreen(const Bird *bird);
+		static void InterpolateLayer(const std::vector<SpriteSnapshot> &previous, const std::vector<SpriteSnapshot> &current, float alpha, const SpriteLayer &layer, std::vector<sf::Sprite> &drawn);
+
+		void DrawBirds();
 
 		sf::Sound _hitSound;
 		sf::Sound _wingSound;
@@ -0,0 +1,439 @@
+#include "GenerationFile.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <nlohmann/json.hpp>
+
+using json = nlohmann::json;
+
+namespace
+{
+	// What the parser is inside of
+	enum class Scope { Root, Chromosome, Layer, Neuron, Output, Weights, Skipped };
+	// What the last key said the next value is
+	enum class Field { Unknown, Chromosome, Seed, Stage, TicksSimulated, TicksSaved, Layer, Output, Neuron, Score, Ticks, Weights, Bias };
+
+	// The number after prefix, or -1 if key isn't prefix followed by one below limit
+	int ParseIndex(const std::string& key, const char* prefix, int limit)
+	{
+		size_t length = std::strlen(prefix);
+		if (key.size() <= length || key.compare(0, length, prefix) != 0)
+			return -1;
+
+		char* end;
+		long index = std::strtol(key.c_str() + length, &end, 10);
+		if (*end != '\0' || index < 0 || index >= limit)
+			return -1;
+
+		return (int)index;
+	}
+
+	class GenerationHandler : public json::json_sax_t
+	{
+	public:
+		GenerationHandler(Generation& generation) : _generation(generation), _genesRead(generation.chromosomes.size(), 0) { }
+
+		bool null() override { return IsInObject(); }
+		bool boolean(bool) override { return IsInObject(); }
+		bool number_integer(json::number_integer_t value) override { return Number(value); }
+		bool number_unsigned(json::number_unsigned_t value) override { return Number(value); }
+		bool number_float(json::number_float_t value, const json::string_t&) override { return Number(value); }
+		bool string(json::string_t&) override { return IsInObject(); }
+		bool binary(json::binary_t&) override { return IsInObject(); }
+
+		bool start_object(std::size_t) override
+		{
+			if (_scopes.empty())
+			{
+				_scopes.push_back(Scope::Root);
+				return true;
+			}
+
+			Scope scope = _scopes.back();
+
+			if (scope == Scope::Root && _field == Field::Chromosome)
+				_scopes.push_back(Scope::Chromosome);
+			else if (scope == Scope::Chromosome && _field == Field::Layer)
+				_scopes.push_back(Scope::Layer);
+			else if (scope == Scope::Layer && _field == Field::Neuron)
+			{
+				_scopes.push_back(Scope::Neuron);
+				_offset = GenerationFile::GetNeuronOffset(_layer, _index);
+				_weightCount = GenerationFile::GetWeightCount(_layer);
+			}
+			else if (scope == Scope::Chromosome && _field == Field::Output)
+			{
+				_scopes.push_back(Scope::Output);
+				_offset = GenerationFile::GetOutputOffset();
+				_weightCount = NEURONS_PER_HIDDEN_LAYER;
+			}
+			else
+				_scopes.push_back(Scope::Skipped);
+
+			_field = Field::Unknown;
+			return true;
+		}
+
+		bool end_object() override
+		{
+			_scopes.pop_back();
+			_field = Field::Unknown;
+			return true;
+		}
+
+		bool start_array(std::size_t) override
+		{
+			if (!IsInObject())
+				return false;
+
+			Scope scope = _scopes.back();
+
+			if ((scope == Scope::Neuron || scope == Scope::Output) && _field == Field::Weights)
+			{
+				_scopes.push_back(Scope::Weights);
+				_weight = 0;
+			}
+			else
+				_scopes.push_back(Scope::Skipped);
+
+			return true;
+		}
+
+		bool end_array() override
+		{
+			_scopes.pop_back();
+			_field = Field::Unknown;
+			return true;
+		}
+
+		bool key(json::string_t& key) override
+		{
+			_field = Field::Unknown;
+
+			switch (_scopes.back())
+			{
+			case Scope::Root:
+				if ((_chromosome = ParseIndex(key, JSON_CHROMOSOME, (int)_generation.chromosomes.size())) >= 0)
+					_field = Field::Chromosome;
+				else if (key == JSON_SEED)
+					_field = Field::Seed;
+				else if (key == JSON_STAGE)
+					_field = Field::Stage;
+				else if (key == JSON_TICKS_SIMULATED)
+					_field = Field::TicksSimulated;
+				else if (key == JSON_TICKS_SAVED)
+					_field = Field::TicksSaved;
+				break;
+
+			case Scope::Chromosome:
+				if ((_layer = ParseIndex(key, JSON_LAYER, HIDDEN_LAYER_COUNT)) >= 0)
+					_field = Field::Layer;
+				else if (key == JSON_OUTPUT)
+					_field = Field::Output;
+				else if (key == JSON_SCORE)
+					_field = Field::Score;
+				else if (key == JSON_STAGE)
+					_field = Field::Stage;
+				else if (key == JSON_TICKS)
+					_field = Field::Ticks;
+				break;
+
+			case Scope::Layer:
+				if ((_index = ParseIndex(key, JSON_NEURON, NEURONS_PER_HIDDEN_LAYER)) >= 0)
+					_field = Field::Neuron;
+				break;
+
+			case Scope::Neuron:
+			case Scope::Output:
+				if (key == JSON_WEIGHTS)
+					_field = Field::Weights;
+				else if (key == JSON_BIAS)
+					_field = Field::Bias;
+				break;
+
+			default:
+				break;
+			}
+
+			return true;
+		}
+
+		bool parse_error(std::size_t, const std::string&, const nlohmann::detail::exception& exception) override
+		{
+			error = exception.what();
+			return false;
+		}
+
+		int GetGenesRead(int chromosome) const { return _genesRead[chromosome]; }
+
+		std::string error;
+
+	private:
+		Generation& _generation;
+		std::vector<Scope> _scopes;
+		Field _field = Field::Unknown;
+
+		int _chromosome = -1;
+		int _layer = -1;
+		int _index = -1;
+		// The current neuron's first weight in the genome
+		int _offset = 0;
+		int _weightCount = 0;
+		int _weight = 0;
+
+		// Counted so a chromosome missing part of its network is caught
+		std::vector<int> _genesRead;
+
+		// A generation is an object, so anything else at the top isn't one
+		bool IsInObject()
+		{
+			if (!_scopes.empty())
+				return true;
+
+			error = "The root isn't an object";
+			return false;
+		}
+
+		template <typename T>
+		bool Number(T value)
+		{
+			if (!IsInObject())
+				return false;
+
+			// Only ever used inside a chromosome, where there is one
+			Chromosome* chromosome = _chromosome >= 0 ? &_generation.chromosomes[_chromosome] : nullptr;
+
+			switch (_scopes.back())
+			{
+			case Scope::Weights:
+				if (_weight >= _weightCount)
+				{
+					error = std::string("A neuron in ") + JSON_CHROMOSOME + std::to_string(_chromosome) + " has too many weights";
+					return false;
+				}
+				chromosome->genes[_offset + _weight++] = (float)value;
+				_genesRead[_chromosome]++;
+				break;
+
+			case Scope::Neuron:
+			case Scope::Output:
+				if (_field == Field::Bias)
+				{
+					chromosome->genes[_offset + _weightCount] = (float)value;
+					_genesRead[_chromosome]++;
+				}
+				break;
+
+			case Scope::Chromosome:
+				if (_field == Field::Score)
+				{
+					chromosome->scored = true;
+					chromosome->score = (int)value;
+				}
+				else if (_field == Field::Stage)
+				{
+					chromosome->flown = true;
+					chromosome->stage = (int)value;
+				}
+				else if (_field == Field::Ticks)
+				{
+					chromosome->flown = true;
+					chromosome->ticks = (unsigned int)value;
+				}
+				break;
+
+			case Scope::Root:
+				if (_field == Field::Seed)
+				{
+					_generation.hasSeed = true;
+					_generation.seed = (unsigned int)value;
+				}
+				else if (_field == Field::Stage)
+				{
+					_generation.hasStage = true;
+					_generation.stage = (int)value;
+				}
+				else if (_field == Field::TicksSimulated)
+					_generation.ticksSimulated = (unsigned int)value;
+				else if (_field == Field::TicksSaved)
+				{
+					_generation.hasTicksSaved = true;
+					_generation.ticksSaved = (long long)value;
+				}
+				break;
+
+			default:
+				break;
+			}
+
+			return true;
+		}
+	};
+
+	// Enough digits that reading it back gives the same float
+	void WriteGene(std::ostream& out, float gene)
+	{
+		// As nlohmann writes them, there's no JSON for these
+		if (!std::isfinite(gene))
+		{
+			out << "null";
+			return;
+		}
+
+		char text[32];
+		std::snprintf(text, sizeof(text), "%.9g", gene);
+		out << text;
+	}
+
+	void WriteNeuron(std::ostream& out, const float* genes, int weightCount, const char* indent)
+	{
+		out << indent << "    \"" << JSON_BIAS << "\": ";
+		WriteGene(out, genes[weightCount]);
+		out << ",\n" << indent << "    \"" << JSON_WEIGHTS << "\": [\n";
+
+		for (int weight = 0; weight < weightCount; weight++)
+		{
+			out << indent << "        ";
+			WriteGene(out, genes[weight]);
+			out << (weight < weightCount - 1 ? ",\n" : "\n");
+		}
+
+		out << indent << "    ]\n";
+	}
+}
+
+bool GenerationFile::Load(const std::string& filePath, Generation& generation)
+{
+	std::ifstream f(filePath);
+	if (!f.good())
+		return false;
+
+	std::string error;
+	if (!Read(f, generation, error))
+	{
+		std::cout << "Error Loading " << filePath << ", " << error << std::endl;
+		return false;
+	}
+
+	return true;
+}
+
+bool GenerationFile::Save(const std::string& filePath, const Generation& generation)
+{
+	std::ofstream o(filePath);
+	Write(o, generation);
+	o.close();
+
+	if (!o.good())
+	{
+		std::cout << "Error Saving " << filePath << std::endl;
+		return false;
+	}
+
+	return true;
+}
+
+bool GenerationFile::Read(std::istream& in, Generation& generation, std::string& error)
+{
+	generation = Generation();
+
+	GenerationHandler handler(generation);
+	if (!json::sax_parse(in, &handler))
+	{
+		error = handler.error;
+		return false;
+	}
+
+	for (int chromosome = 0; chromosome < (int)generation.chromosomes.size(); chromosome++)
+	{
+		if (handler.GetGenesRead(chromosome) != GENOME_SIZE)
+		{
+			error = std::string(JSON_CHROMOSOME) + std::to_string(chromosome) + " has " + std::to_string(handler.GetGenesRead(chromosome))
+				+ " of its " + std::to_string(GENOME_SIZE) + " weights and biases";
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void GenerationFile::Write(std::ostream& out, const Generation& generation)
+{
+	// The same layout as json::dump(4), a chromosome at a time
+	out << "{\n";
+
+	for (int index = 0; index < (int)generation.chromosomes.size(); index++)
+	{
+		const Chromosome& chromosome = generation.chromosomes[index];
+
+		out << "    \"" << JSON_CHROMOSOME << index << "\": {\n";
+
+		for (int layer = 0; layer < HIDDEN_LAYER_COUNT; layer++)
+		{
+			out << "        \"" << JSON_LAYER << layer << "\": {\n";
+
+			for (int neuron = 0; neuron < NEURONS_PER_HIDDEN_LAYER; neuron++)
+			{
+				out << "            \"" << JSON_NEURON << neuron << "\": {\n";
+				WriteNeuron(out, chromosome.genes + GetNeuronOffset(layer, neuron), GetWeightCount(layer), "            ");
+				out << "            }" << (neuron < NEURONS_PER_HIDDEN_LAYER - 1 ? ",\n" : "\n");
+			}
+
+			out << "        },\n";
+		}
+
+		out << "        \"" << JSON_OUTPUT << "\": {\n";
+		WriteNeuron(out, chromosome.genes + GetOutputOffset(), NEURONS_PER_HIDDEN_LAYER, "        ");
+		out << "        }";
+
+		if (chromosome.scored)
+			out << ",\n        \"" << JSON_SCORE << "\": " << chromosome.score;
+		if (chromosome.flown)
+			out << ",\n        \"" << JSON_STAGE << "\": " << chromosome.stage
+				<< ",\n        \"" << JSON_TICKS << "\": " << chromosome.ticks;
+
+		bool last = index == (int)generation.chromosomes.size() - 1 && !generation.hasSeed && !generation.hasStage
+			&& !generation.hasTicksSaved && generation.ticksSimulated == 0;
+		out << "\n    }" << (last ? "\n" : ",\n");
+	}
+
+	// Comma separated, as whichever is set last can't have one after it
+	const char* separator = "";
+	if (generation.hasSeed)
+	{
+		out << separator << "    \"" << JSON_SEED << "\": " << generation.seed;
+		separator = ",\n";
+	}
+	if (generation.hasStage)
+	{
+		out << separator << "    \"" << JSON_STAGE << "\": " << generation.stage;
+		separator = ",\n";
+	}
+	if (generation.hasTicksSaved)
+	{
+		out << separator << "    \"" << JSON_TICKS_SAVED << "\": " << generation.ticksSaved;
+		separator = ",\n";
+	}
+	if (generation.ticksSimulated > 0)
+	{
+		out << separator << "    \"" << JSON_TICKS_SIMULATED << "\": " << generation.ticksSimulated;
+		separator = ",\n";
+	}
+	if (*separator != '\0')
+		out << "\n";
+
+	out << "}" << std::endl;
+}
+
+int GenerationFile::GetNeuronOffset(int layer, int neuron)
+{
+	int offset = 0;
+	for (int earlier = 0; earlier < layer; earlier++)
+		offset += NEURONS_PER_HIDDEN_LAYER * (GetWeightCount(earlier) + 1);
+
+	return offset + neuron * (GetWeightCount(layer) + 1);
+}
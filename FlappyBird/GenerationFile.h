@@ -0,0 +1,70 @@
+#pragma once
+
+#include "DEFINITIONS.hpp"
+
+#include <istream>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Every weight and bias of one network, in the order the genetic encoding uses:
+// each hidden neuron's weights then its bias, layer by layer, then the output neuron's
+const int GENOME_SIZE = NEURONS_PER_HIDDEN_LAYER * (INPUT_COUNT + 1)
+	+ (HIDDEN_LAYER_COUNT - 1) * NEURONS_PER_HIDDEN_LAYER * (NEURONS_PER_HIDDEN_LAYER + 1)
+	+ NEURONS_PER_HIDDEN_LAYER + 1;
+
+struct Chromosome
+{
+	float genes[GENOME_SIZE] = {};
+
+	// Cleared to put it back in the running for the next stage
+	bool scored = false;
+	int score = 0;
+
+	// The stage and length of the last episode it flew in, if it has flown
+	bool flown = false;
+	int stage = 0;
+	unsigned int ticks = 0;
+};
+
+// A generation as its file holds it, the genes in flat arrays rather than a tree of JSON
+struct Generation
+{
+	Generation() : chromosomes(BIRD_COUNT) { }
+
+	std::vector<Chromosome> chromosomes;
+
+	bool hasStage = false;
+	int stage = 0;
+
+	bool hasSeed = false;
+	unsigned int seed = 0;
+
+	// Not written while 0
+	unsigned int ticksSimulated = 0;
+
+	// What the birds racing dropped while they were still flying had left of the final stage's limit
+	bool hasTicksSaved = false;
+	long long ticksSaved = 0;
+};
+
+// Reads and writes the generation_N.json files without building a DOM. Reading
+// goes through a SAX handler that puts each number straight into its gene, and
+// writing prints the same schema a chromosome at a time, so neither holds more
+// than a token or a chromosome's worth of text at once.
+class GenerationFile
+{
+public:
+	// False if the file is missing or isn't a generation
+	static bool Load(const std::string& filePath, Generation& generation);
+	static bool Save(const std::string& filePath, const Generation& generation);
+
+	// Anything Read doesn't recognise is skipped, chromosomes past BIRD_COUNT included
+	static bool Read(std::istream& in, Generation& generation, std::string& error);
+	static void Write(std::ostream& out, const Generation& generation);
+
+	// Where a neuron's weights start in the genome, its bias follows them
+	static int GetNeuronOffset(int layer, int neuron);
+	static int GetOutputOffset() { return GENOME_SIZE - NEURONS_PER_HIDDEN_LAYER - 1; }
+	static int GetWeightCount(int layer) { return layer == 0 ? INPUT_COUNT : NEURONS_PER_HIDDEN_LAYER; }
+};
@@ -0,0 +1,240 @@
+#include "GenerationStats.h"
+#include "DEFINITIONS.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+namespace
+{
+	const char STATS_MAGIC[4] = { 'F', 'B', 'G', 'S' };
+	const std::uint32_t STATS_VERSION = 2;
+	// Each column's name is padded to this, with its type in the last byte
+	const int STATS_COLUMN_NAME_SIZE = 32;
+
+	// i is int32, u uint32, U uint64 and d float64, in record order
+	struct Column
+	{
+		const char* name;
+		char type;
+	};
+
+	const Column STATS_COLUMNS[] = {
+		{ "generation", 'i' },
+		{ "seed", 'u' },
+		{ "stage", 'i' },
+		{ "scored", 'i' },
+		{ "min_score", 'd' },
+		{ "mean_score", 'd' },
+		{ "median_score", 'd' },
+		{ "max_score", 'd' },
+		{ "score_stddev", 'd' },
+		{ "evaluation_seconds", 'd' },
+		{ "ticks_simulated", 'U' },
+		{ "diversity", 'd' },
+	};
+	const std::uint32_t STATS_COLUMN_COUNT = sizeof(STATS_COLUMNS) / sizeof(STATS_COLUMNS[0]);
+
+	std::uint32_t GetRecordSize()
+	{
+		std::uint32_t size = 0;
+		for (const Column& column : STATS_COLUMNS)
+			size += column.type == 'U' || column.type == 'd' ? 8 : 4;
+		return size;
+	}
+
+	template <typename T>
+	void Put(char*& out, T value)
+	{
+		std::memcpy(out, &value, sizeof(T));
+		out += sizeof(T);
+	}
+}
+
+GenerationStats GenerationStats::Measure(const Generation& generation, int generationNum, unsigned int seed, double evaluationSeconds)
+{
+	GenerationStats stats;
+	stats.generation = generationNum;
+	stats.seed = seed;
+	stats.evaluationSeconds = evaluationSeconds;
+	stats.ticksSimulated = generation.ticksSimulated;
+
+	// Generations saved before stages were recorded raced everyone in stage 0
+	for (const Chromosome& chromosome : generation.chromosomes)
+		if (chromosome.scored && chromosome.flown)
+			stats.stage = std::max(stats.stage, chromosome.stage);
+
+	std::vector<double> scores;
+	double geneSums[GENOME_SIZE] = {};
+	double geneSquareSums[GENOME_SIZE] = {};
+
+	for (const Chromosome& chromosome : generation.chromosomes)
+	{
+		if (chromosome.scored && (chromosome.flown ? chromosome.stage : 0) == stats.stage)
+			scores.push_back(chromosome.score);
+
+		for (int gene = 0; gene < GENOME_SIZE; gene++)
+		{
+			geneSums[gene] += chromosome.genes[gene];
+			geneSquareSums[gene] += (double)chromosome.genes[gene] * chromosome.genes[gene];
+		}
+	}
+
+	double population = (double)generation.chromosomes.size();
+	if (population > 0)
+	{
+		double deviations = 0;
+		for (int gene = 0; gene < GENOME_SIZE; gene++)
+		{
+			double mean = geneSums[gene] / population;
+			deviations += std::sqrt(std::max(0.0, geneSquareSums[gene] / population - mean * mean));
+		}
+		stats.diversity = deviations / GENOME_SIZE;
+	}
+
+	stats.scored = (int)scores.size();
+	if (scores.empty())
+		return stats;
+
+	std::sort(scores.begin(), scores.end());
+
+	double total = 0;
+	for (double score : scores)
+		total += score;
+
+	stats.minScore = scores.front();
+	stats.maxScore = scores.back();
+	stats.meanScore = total / scores.size();
+
+	size_t middle = scores.size() / 2;
+	stats.medianScore = scores.size() % 2 == 1 ? scores[middle] : (scores[middle - 1] + scores[middle]) / 2;
+
+	double squaredDeviations = 0;
+	for (double score : scores)
+		squaredDeviations += (score - stats.meanScore) * (score - stats.meanScore);
+	stats.scoreStdDev = std::sqrt(squaredDeviations / scores.size());
+
+	return stats;
+}
+
+bool GenerationStats::Append(const std::string& binaryFilePath, const std::string& csvFilePath) const
+{
+	// Only add to a file laid out the same way, rather than leave rows nothing can read
+	if (!CanAppend(binaryFilePath))
+		return false;
+
+	bool writeHeader;
+	{
+		std::ifstream existing(binaryFilePath, std::ios::binary);
+		writeHeader = !existing.good() || existing.peek() == std::ifstream::traits_type::eof();
+	}
+
+	std::ofstream binary(binaryFilePath, std::ios::binary | std::ios::app);
+	if (!binary.good())
+	{
+		std::cout << "Error Opening " << binaryFilePath << std::endl;
+		return false;
+	}
+
+	if (writeHeader)
+		binary << GetHeader();
+	binary << GetRecord();
+	binary.close();
+
+	bool writeCsvHeader = !std::ifstream(csvFilePath).good();
+
+	std::ofstream csv(csvFilePath, std::ios::out | std::ios::app);
+	if (!csv.good())
+	{
+		std::cout << "Error Opening " << csvFilePath << std::endl;
+		return false;
+	}
+
+	if (writeCsvHeader)
+		csv << GetCsvHeader();
+	csv << GetCsvLine();
+
+	return binary.good() && csv.good();
+}
+
+std::string GenerationStats::GetHeader()
+{
+	std::string header(STATS_MAGIC, sizeof(STATS_MAGIC));
+
+	std::uint32_t counts[3] = { STATS_VERSION, STATS_COLUMN_COUNT, GetRecordSize() };
+	header.append((const char*)counts, sizeof(counts));
+
+	for (const Column& column : STATS_COLUMNS)
+	{
+		char name[STATS_COLUMN_NAME_SIZE] = {};
+		std::strncpy(name, column.name, STATS_COLUMN_NAME_SIZE - 1);
+		name[STATS_COLUMN_NAME_SIZE - 1] = column.type;
+		header.append(name, sizeof(name));
+	}
+
+	return header;
+}
+
+std::string GenerationStats::GetRecord() const
+{
+	std::string record(GetRecordSize(), '\0');
+	char* out = &record[0];
+	Put<std::int32_t>(out, generation);
+	Put<std::uint32_t>(out, seed);
+	Put<std::int32_t>(out, stage);
+	Put<std::int32_t>(out, scored);
+	Put<double>(out, minScore);
+	Put<double>(out, meanScore);
+	Put<double>(out, medianScore);
+	Put<double>(out, maxScore);
+	Put<double>(out, scoreStdDev);
+	Put<double>(out, evaluationSeconds);
+	Put<std::uint64_t>(out, ticksSimulated);
+	Put<double>(out, diversity);
+
+	return record;
+}
+
+std::string GenerationStats::GetCsvHeader()
+{
+	std::string header;
+	for (std::uint32_t column = 0; column < STATS_COLUMN_COUNT; column++)
+		header += std::string(column > 0 ? "," : "") + STATS_COLUMNS[column].name;
+
+	return header + "\n";
+}
+
+std::string GenerationStats::GetCsvLine() const
+{
+	std::ostringstream line;
+	line << generation << "," << seed << "," << stage << "," << scored
+		<< "," << minScore << "," << meanScore << "," << medianScore << "," << maxScore << "," << scoreStdDev
+		<< "," << evaluationSeconds << "," << ticksSimulated << "," << diversity << "\n";
+
+	return line.str();
+}
+
+bool GenerationStats::CanAppend(const std::string& binaryFilePath)
+{
+	std::ifstream existing(binaryFilePath, std::ios::binary);
+	if (!existing.good() || existing.peek() == std::ifstream::traits_type::eof())
+		return true;
+
+	char magic[4];
+	std::uint32_t header[3];
+	existing.read(magic, sizeof(magic));
+	existing.read((char*)header, sizeof(header));
+
+	if (!existing.good() || std::memcmp(magic, STATS_MAGIC, sizeof(magic)) != 0
+		|| header[0] != STATS_VERSION || header[1] != STATS_COLUMN_COUNT || header[2] != GetRecordSize())
+	{
+		std::cout << "Error Appending To " << binaryFilePath << ", it has a different layout" << std::endl;
+		return false;
+	}
+
+	return true;
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "GenerationFile.h"
+
+#include <string>
+
+// One generation's summary, appended as training goes so progress can be
+// plotted without re-reading every generation file.
+//
+// The binary file starts with a header naming each column, followed by one
+// fixed size little endian record per generation, so a reader can stride
+// straight to any column. The CSV file gets the same rows as text.
+// A run stopped between appending and saving the next generation repeats
+// that generation when resumed, so readers should take the last row for each.
+struct GenerationStats
+{
+	int generation = 0;
+	unsigned int seed = 0;
+	// The last stage raced. Earlier stages flew shorter courses, so the scores only
+	// cover the chromosomes that reached this one, and scored counts those
+	int stage = 0;
+	int scored = 0;
+
+	double minScore = 0;
+	double meanScore = 0;
+	double medianScore = 0;
+	double maxScore = 0;
+	double scoreStdDev = 0;
+
+	double evaluationSeconds = 0;
+	unsigned long long ticksSimulated = 0;
+	// Mean over every gene of its standard deviation across the population
+	double diversity = 0;
+
+	static GenerationStats Measure(const Generation& generation, int generationNum, unsigned int seed, double evaluationSeconds);
+
+	// False if either file couldn't be written, or the binary file has a different layout
+	bool Append(const std::string& binaryFilePath, const std::string& csvFilePath) const;
+
+	// What Append writes, for appending through a BackgroundWriter that starts each file with its header
+	static std::string GetHeader();
+	std::string GetRecord() const;
+	static std::string GetCsvHeader();
+	std::string GetCsvLine() const;
+	// False if the binary file has a different layout, true if it's the same or missing
+	static bool CanAppend(const std::string& binaryFilePath);
+};
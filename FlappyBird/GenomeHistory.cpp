@@ -0,0 +1,415 @@
+#include "GenomeHistory.h"
+#include "StateStream.hpp"
+
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+
+namespace
+{
+	const char HISTORY_MAGIC[4] = { 'F', 'B', 'G', 'H' };
+	const std::uint32_t HISTORY_VERSION = 1;
+	const size_t HISTORY_HEADER_SIZE = sizeof(HISTORY_MAGIC) + 3 * sizeof(std::uint32_t);
+
+	enum class RecordType : std::uint8_t { Keyframe, Bred, Scores };
+
+	// Each record starts with its generation and type
+	const size_t RECORD_HEADER_SIZE = sizeof(std::int32_t) + sizeof(RecordType);
+	const size_t KEYFRAME_SIZE = BIRD_COUNT * GENOME_SIZE * sizeof(float);
+	// Both parents, the crossover and the mutation seed of every child
+	const size_t BREEDING_SIZE = 2 * sizeof(std::uint16_t) + sizeof(Crossover) + sizeof(std::uint32_t);
+	const size_t BRED_SIZE = BIRD_COUNT * BREEDING_SIZE;
+	// The generation's flags, stage, seed and tick counts, then each chromosome's flags, score, stage and ticks
+	const size_t SCORES_SIZE = sizeof(std::uint8_t) + sizeof(std::int32_t) + 2 * sizeof(std::uint32_t) + sizeof(std::int64_t)
+		+ BIRD_COUNT * (sizeof(std::uint8_t) + 2 * sizeof(std::int32_t) + sizeof(std::uint32_t));
+
+	const size_t NO_RECORD = (size_t)-1;
+
+	void WriteHeader(Sonar::StateWriter& out)
+	{
+		for (char c : HISTORY_MAGIC)
+			out.Write(c);
+		out.Write<std::uint32_t>(HISTORY_VERSION);
+		out.Write<std::uint32_t>(GENOME_SIZE);
+		out.Write<std::uint32_t>(BIRD_COUNT);
+	}
+
+	// 0 for a type this doesn't know
+	size_t GetRecordSize(RecordType type)
+	{
+		switch (type)
+		{
+		case RecordType::Keyframe: return RECORD_HEADER_SIZE + KEYFRAME_SIZE;
+		case RecordType::Bred: return RECORD_HEADER_SIZE + BRED_SIZE;
+		case RecordType::Scores: return RECORD_HEADER_SIZE + SCORES_SIZE;
+		default: return 0;
+		}
+	}
+
+	bool ReadHeader(Sonar::StateReader& in)
+	{
+		char magic[sizeof(HISTORY_MAGIC)];
+		in.ReadBytes(magic, sizeof(magic));
+		std::uint32_t version = in.Read<std::uint32_t>();
+		std::uint32_t genomeSize = in.Read<std::uint32_t>();
+		std::uint32_t birdCount = in.Read<std::uint32_t>();
+
+		return in.IsValid() && std::memcmp(magic, HISTORY_MAGIC, sizeof(magic)) == 0
+			&& version == HISTORY_VERSION && genomeSize == GENOME_SIZE && birdCount == BIRD_COUNT;
+	}
+
+	// False if the file starts with another history's header. hasHeader is false if it's missing or empty
+	bool CheckExisting(const std::string& filePath, bool& hasHeader)
+	{
+		hasHeader = false;
+
+		std::ifstream existing(filePath, std::ios::binary);
+		if (!existing.good() || existing.peek() == std::ifstream::traits_type::eof())
+			return true;
+
+		char header[HISTORY_HEADER_SIZE];
+		existing.read(header, sizeof(header));
+
+		Sonar::StateReader in(header, existing.good() ? sizeof(header) : 0);
+		if (!ReadHeader(in))
+		{
+			std::cout << "Error Appending To " << filePath << ", it has a different layout" << std::endl;
+			return false;
+		}
+
+		hasHeader = true;
+		return true;
+	}
+}
+
+GenomeHistory::GenomeHistory() : _uses(0)
+{
+}
+
+bool GenomeHistory::Open(const std::string& filePath)
+{
+	_data.clear();
+	_records.clear();
+	_scores.clear();
+	_cache.clear();
+
+	std::ifstream f(filePath, std::ios::binary);
+	if (!f.good())
+		return false;
+
+	_data.assign(std::istreambuf_iterator<char>(f), std::istreambuf_iterator<char>());
+
+	Sonar::StateReader in(_data.data(), _data.size());
+	if (!ReadHeader(in))
+	{
+		std::cout << "Error Opening " << filePath << ", it isn't a genome history for this population" << std::endl;
+		_data.clear();
+		return false;
+	}
+
+	size_t offset = HISTORY_HEADER_SIZE;
+	while (offset < _data.size())
+	{
+		Sonar::StateReader record(_data.data() + offset, _data.size() - offset);
+		int generation = record.Read<std::int32_t>();
+		RecordType type = record.Read<RecordType>();
+		size_t size = GetRecordSize(type);
+
+		// A record cut short by a crash is where the history ends
+		if (!record.IsValid() || generation < 0 || size == 0 || size > record.GetRemaining() + RECORD_HEADER_SIZE)
+			break;
+
+		// Scores with no genes before them aren't any use
+		if (type == RecordType::Scores && (generation > GetLastGeneration() || _records[generation] == NO_RECORD))
+			break;
+
+		// Anything recorded for later generations came before this one, from a run it replaced
+		_records.resize(generation + 1, NO_RECORD);
+		_scores.resize(generation + 1, NO_RECORD);
+		if (type == RecordType::Scores)
+			_scores[generation] = offset;
+		else
+		{
+			_records[generation] = offset;
+			// From the genes this replaces
+			_scores[generation] = NO_RECORD;
+		}
+
+		offset += size;
+	}
+
+	return true;
+}
+
+std::shared_ptr<const Generation> GenomeHistory::Rebuild(int generation)
+{
+	if (generation < 0 || generation > GetLastGeneration() || _records[generation] == NO_RECORD)
+		return nullptr;
+
+	std::shared_ptr<const Generation> cached;
+	if (FindCached(generation, cached))
+		return cached;
+
+	// Back to the nearest generation that needs no breeding
+	int start = generation;
+	while (!IsKeyframe(start))
+	{
+		start--;
+		if (start < 0 || _records[start] == NO_RECORD)
+		{
+			std::cout << "Error Rebuilding Generation " << generation << ", the history is missing generation " << start << std::endl;
+			return nullptr;
+		}
+
+		if (FindCached(start, cached))
+			break;
+	}
+
+	Generation parents;
+	if (cached)
+		parents = *cached;
+	else
+	{
+		Sonar::StateReader in(_data.data() + _records[start] + RECORD_HEADER_SIZE, KEYFRAME_SIZE);
+		for (Chromosome& chromosome : parents.chromosomes)
+			in.ReadBytes(chromosome.genes, sizeof(chromosome.genes));
+	}
+
+	Generation children;
+	for (int generationNum = start + 1; generationNum <= generation; generationNum++)
+	{
+		Sonar::StateReader in(_data.data() + _records[generationNum] + RECORD_HEADER_SIZE, BRED_SIZE);
+
+		for (Chromosome& child : children.chromosomes)
+		{
+			Breeding breeding;
+			breeding.parents[0] = in.Read<std::uint16_t>();
+			breeding.parents[1] = in.Read<std::uint16_t>();
+			breeding.crossover = in.Read<Crossover>();
+			breeding.mutationSeed = in.Read<std::uint32_t>();
+
+			if (breeding.parents[0] >= BIRD_COUNT || breeding.parents[1] >= BIRD_COUNT)
+			{
+				std::cout << "Error Rebuilding Generation " << generation << ", generation " << generationNum << " has a parent out of range" << std::endl;
+				return nullptr;
+			}
+
+			Breed(parents.chromosomes[breeding.parents[0]].genes, parents.chromosomes[breeding.parents[1]].genes, breeding, generationNum, child.genes);
+		}
+
+		std::swap(parents, children);
+	}
+
+	ReadScores(generation, parents);
+
+	std::shared_ptr<const Generation> rebuilt = std::make_shared<const Generation>(std::move(parents));
+	AddToCache(generation, rebuilt);
+
+	return rebuilt;
+}
+
+std::vector<char> GenomeHistory::GetKeyframe(int generationNum, const Generation& generation)
+{
+	std::vector<char> record;
+	record.reserve(RECORD_HEADER_SIZE + KEYFRAME_SIZE);
+
+	Sonar::StateWriter out(record);
+	out.Write<std::int32_t>(generationNum);
+	out.Write(RecordType::Keyframe);
+	for (const Chromosome& chromosome : generation.chromosomes)
+		for (float gene : chromosome.genes)
+			out.Write(gene);
+
+	return record;
+}
+
+std::vector<char> GenomeHistory::GetBred(int generationNum, const Breeding* breedings)
+{
+	std::vector<char> record;
+	record.reserve(RECORD_HEADER_SIZE + BRED_SIZE);
+
+	Sonar::StateWriter out(record);
+	out.Write<std::int32_t>(generationNum);
+	out.Write(RecordType::Bred);
+	for (int child = 0; child < BIRD_COUNT; child++)
+	{
+		out.Write<std::uint16_t>(breedings[child].parents[0]);
+		out.Write<std::uint16_t>(breedings[child].parents[1]);
+		out.Write(breedings[child].crossover);
+		out.Write<std::uint32_t>(breedings[child].mutationSeed);
+	}
+
+	return record;
+}
+
+std::vector<char> GenomeHistory::GetScores(int generationNum, const Generation& generation)
+{
+	std::vector<char> record;
+	record.reserve(RECORD_HEADER_SIZE + SCORES_SIZE);
+
+	Sonar::StateWriter out(record);
+	out.Write<std::int32_t>(generationNum);
+	out.Write(RecordType::Scores);
+	out.Write<std::uint8_t>((generation.hasStage ? 1 : 0) | (generation.hasSeed ? 2 : 0) | (generation.hasTicksSaved ? 4 : 0));
+	out.Write<std::int32_t>(generation.stage);
+	out.Write<std::uint32_t>(generation.seed);
+	out.Write<std::uint32_t>(generation.ticksSimulated);
+	out.Write<std::int64_t>(generation.ticksSaved);
+
+	for (const Chromosome& chromosome : generation.chromosomes)
+	{
+		out.Write<std::uint8_t>((chromosome.scored ? 1 : 0) | (chromosome.flown ? 2 : 0));
+		out.Write<std::int32_t>(chromosome.score);
+		out.Write<std::int32_t>(chromosome.stage);
+		out.Write<std::uint32_t>(chromosome.ticks);
+	}
+
+	return record;
+}
+
+std::string GenomeHistory::GetHeader()
+{
+	std::vector<char> header;
+	Sonar::StateWriter out(header);
+	WriteHeader(out);
+	return std::string(header.begin(), header.end());
+}
+
+void GenomeHistory::Breed(const float* first, const float* second, const Breeding& breeding, int generationNum, float* child)
+{
+	std::minstd_rand random(breeding.mutationSeed);
+
+	for (int gene = 0; gene < GENOME_SIZE; gene++)
+	{
+		// The same as crossing over the bit strings in AIController::CreateNewGeneration, 32 bits to a gene
+		const float* parent = breeding.crossover == Crossover::AlternateGenes && gene % 2 == 1 ? second : first;
+		child[gene] = Mutate(parent[gene], generationNum, random);
+	}
+}
+
+float GenomeHistory::Mutate(float gene, int generationNum, std::minstd_rand& random)
+{
+	// Mutation
+	if (random() % 100 < 1)
+	{
+		float max = 1.0f;
+
+		if (generationNum < 100)
+			max -= generationNum * 0.01f;
+		else
+			max = 0.01f;
+
+		// Evaluates to between -max and max, and shrinks by 0.01 each generation. Then stays at 0.01.
+		float kohonenAdjustment = (static_cast <float> (random() - random.min()) / static_cast <float> ((random.max() - random.min()) / (max * 2))) - max;
+
+		gene += kohonenAdjustment;
+	}
+	return gene;
+}
+
+unsigned int GenomeHistory::GetMutationSeed(unsigned int generationSeed, int child)
+{
+	// Mixed so neighbouring children, and the same child a generation apart, get unrelated streams
+	std::uint32_t seed = (std::uint32_t)generationSeed + (std::uint32_t)child * 0x9E3779B9u;
+	seed ^= seed >> 16;
+	seed *= 0x7FEB352Du;
+	seed ^= seed >> 15;
+	seed *= 0x846CA68Bu;
+	seed ^= seed >> 16;
+	return seed;
+}
+
+bool GenomeHistory::IsKeyframe(int generation) const
+{
+	Sonar::StateReader in(_data.data() + _records[generation] + sizeof(std::int32_t), sizeof(RecordType));
+	return in.Read<RecordType>() == RecordType::Keyframe;
+}
+
+void GenomeHistory::ReadScores(int generation, Generation& rebuilt) const
+{
+	if (_scores[generation] == NO_RECORD)
+		return;
+
+	Sonar::StateReader in(_data.data() + _scores[generation] + RECORD_HEADER_SIZE, SCORES_SIZE);
+	std::uint8_t flags = in.Read<std::uint8_t>();
+	rebuilt.hasStage = (flags & 1) != 0;
+	rebuilt.hasSeed = (flags & 2) != 0;
+	rebuilt.hasTicksSaved = (flags & 4) != 0;
+	rebuilt.stage = in.Read<std::int32_t>();
+	rebuilt.seed = in.Read<std::uint32_t>();
+	rebuilt.ticksSimulated = in.Read<std::uint32_t>();
+	rebuilt.ticksSaved = in.Read<std::int64_t>();
+
+	for (Chromosome& chromosome : rebuilt.chromosomes)
+	{
+		flags = in.Read<std::uint8_t>();
+		chromosome.scored = (flags & 1) != 0;
+		chromosome.flown = (flags & 2) != 0;
+		chromosome.score = in.Read<std::int32_t>();
+		chromosome.stage = in.Read<std::int32_t>();
+		chromosome.ticks = in.Read<std::uint32_t>();
+	}
+}
+
+bool GenomeHistory::FindCached(int generation, std::shared_ptr<const Generation>& genes)
+{
+	for (CachedGeneration& cached : _cache)
+	{
+		if (cached.generation != generation)
+			continue;
+
+		cached.lastUsed = ++_uses;
+		genes = cached.genes;
+		return true;
+	}
+
+	return false;
+}
+
+void GenomeHistory::AddToCache(int generation, std::shared_ptr<const Generation> genes)
+{
+	if (_cache.size() < GENOME_HISTORY_CACHE_SIZE)
+	{
+		_cache.push_back(CachedGeneration{ generation, genes, ++_uses });
+		return;
+	}
+
+	std::vector<CachedGeneration>::iterator oldest = _cache.begin();
+	for (std::vector<CachedGeneration>::iterator cached = _cache.begin(); cached != _cache.end(); ++cached)
+		if (cached->lastUsed < oldest->lastUsed)
+			oldest = cached;
+
+	*oldest = CachedGeneration{ generation, genes, ++_uses };
+}
+
+bool GenomeHistory::Append(const std::string& filePath, const std::vector<char>& record)
+{
+	// Only add to a history of the same genome and population, rather than leave records nothing can read
+	bool hasHeader;
+	if (!CheckExisting(filePath, hasHeader))
+		return false;
+
+	std::ofstream o(filePath, std::ios::binary | std::ios::app);
+	if (!o.good())
+	{
+		std::cout << "Error Opening " << filePath << std::endl;
+		return false;
+	}
+
+	if (!hasHeader)
+	{
+		std::string header = GetHeader();
+		o.write(header.data(), header.size());
+	}
+
+	o.write(record.data(), record.size());
+
+	return o.good();
+}
+
+bool GenomeHistory::CanAppend(const std::string& filePath)
+{
+	bool hasHeader;
+	return CheckExisting(filePath, hasHeader);
+}
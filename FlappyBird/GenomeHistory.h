@@ -0,0 +1,89 @@
+#pragma once
+
+#include "GenerationFile.h"
+
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+enum class Crossover : std::uint8_t
+{
+	// A copy of the first parent
+	Clone,
+	// Even genes from the first parent, odd from the second
+	AlternateGenes
+};
+
+// How one child was made from the generation before it
+struct Breeding
+{
+	// Chromosome numbers in the parent generation
+	int parents[2] = { 0, 0 };
+	Crossover crossover = Crossover::Clone;
+	// Seeds the only randomness a child sees after its parents are chosen
+	unsigned int mutationSeed = 0;
+};
+
+// Every generation of a run in one file. Most are stored as how each child
+// was bred, a few bytes a chromosome, with every gene stored in full only
+// every GENOME_HISTORY_KEYFRAME_INTERVAL generations and wherever the chain
+// back to one would be broken, like the first generation bred after a restart.
+//
+// The file starts with a header fixing the genome and population size,
+// followed by one record per generation, and a record of its scores once it
+// finishes. A run stopped between recording and saving a generation records
+// it again when resumed, so the last record for each generation is the one
+// that counts. With its scores recorded, a generation can be rebuilt as its
+// file had it, so the file itself can go, see GENOME_HISTORY_PRUNE.
+class GenomeHistory
+{
+public:
+	GenomeHistory();
+
+	// False if the file is missing or isn't a history
+	bool Open(const std::string& filePath);
+	// -1 if nothing is recorded
+	int GetLastGeneration() const { return (int)_records.size() - 1; }
+	// Null if the generation or one it was bred from is missing. Without its scores recorded only the genes are filled in
+	std::shared_ptr<const Generation> Rebuild(int generation);
+
+	// Records to append, through Append or a BackgroundWriter starting the file with GetHeader
+	static std::vector<char> GetKeyframe(int generationNum, const Generation& generation);
+	static std::vector<char> GetBred(int generationNum, const Breeding* breedings);
+	// Everything but the genes, for a generation already recorded
+	static std::vector<char> GetScores(int generationNum, const Generation& generation);
+	static std::string GetHeader();
+
+	static bool Append(const std::string& filePath, const std::vector<char>& record);
+	// False if filePath is a history of another genome or population, which nothing should be added to
+	static bool CanAppend(const std::string& filePath);
+
+	// The breeding rules, shared by AIController and rebuilding so both come up with the same genes
+	static void Breed(const float* first, const float* second, const Breeding& breeding, int generationNum, float* child);
+	static float Mutate(float gene, int generationNum, std::minstd_rand& random);
+	static unsigned int GetMutationSeed(unsigned int generationSeed, int child);
+
+private:
+	struct CachedGeneration
+	{
+		int generation;
+		std::shared_ptr<const Generation> genes;
+		unsigned long long lastUsed;
+	};
+
+	std::vector<char> _data;
+	// Where each generation's last record of genes starts, or nowhere if it has none
+	std::vector<size_t> _records;
+	// Where the scores recorded after them start, or nowhere
+	std::vector<size_t> _scores;
+
+	std::vector<CachedGeneration> _cache;
+	unsigned long long _uses;
+
+	bool IsKeyframe(int generation) const;
+	bool FindCached(int generation, std::shared_ptr<const Generation>& genes);
+	void AddToCache(int generation, std::shared_ptr<const Generation> genes);
+	void ReadScores(int generation, Generation& rebuilt) const;
+};
@@ -1,6 +1,8 @@
 #include "HUD.hpp"
 
 #include <string>
+#include <sstream>
+#include <iomanip>
 
 namespace Sonar
 {
@@ -17,6 +19,29 @@ namespace Sonar
 		_scoreText.setOrigin(sf::Vector2f(_scoreText.getGlobalBounds().width / 2, _scoreText.getGlobalBounds().height / 2));
 
 		_scoreText.setPosition(sf::Vector2f((float)_data->window.getSize().x / 2, (float)_data->window.getSize().y / 5));
+
+		_speedText.setFont(this->_data->assets.GetFont("Flappy Font"));
+		_speedText.setCharacterSize(32);
+		_speedText.setFillColor(sf::Color::White);
+		_speedText.setPosition(sf::Vector2f(10.0f, 10.0f));
+
+		_shownSpeed = -1;
+
+		_cpuText.setFont(this->_data->assets.GetFont("Flappy Font"));
+		_cpuText.setCharacterSize(32);
+		_cpuText.setFillColor(sf::Color::White);
+		_cpuText.setPosition(sf::Vector2f(10.0f, 46.0f));
+
+		_shownCpu = -1;
+
+#if PROFILING
+		_profilerText.setFont(this->_data->assets.GetFont("Flappy Font"));
+		_profilerText.setCharacterSize(24);
+		_profilerText.setFillColor(sf::Color::White);
+		_profilerText.setOutlineColor(sf::Color::Black);
+		_profilerText.setOutlineThickness(2.0f);
+		_profilerText.setPosition(sf::Vector2f(10.0f, 90.0f));
+#endif
 	}
 
 	HUD::~HUD()
@@ -26,7 +51,63 @@ namespace Sonar
 	void HUD::Draw()
 	{
 		_data->window.draw(_scoreText);
+
+		// Shown to a tenth, and only rebuilt when that changes
+		int speed = (int)(_data->achievedSimulationSpeed * 10.0f + 0.5f);
+		if (speed != _shownSpeed)
+		{
+			std::ostringstream text;
+			text << "x" << std::fixed << std::setprecision(1) << speed / 10.0f;
+			_speedText.setString(text.str());
+
+			_shownSpeed = speed;
+		}
+
+		_data->window.draw(_speedText);
+
+		int cpu = (int)(_data->cpuPerFrame * 10.0f + 0.5f);
+		if (cpu != _shownCpu)
+		{
+			std::ostringstream text;
+			text << std::fixed << std::setprecision(1) << cpu / 10.0f << "ms cpu";
+			_cpuText.setString(text.str());
+
+			_shownCpu = cpu;
+		}
+
+		_data->window.draw(_cpuText);
+
+#if PROFILING
+		if (_data->showProfiler)
+		{
+			// Sorting every zone's history each frame would cost more than most of the zones
+			if (_profilerClock.getElapsedTime().asSeconds() > PROFILER_OVERLAY_REFRESH || _profilerText.getString().isEmpty())
+			{
+				UpdateProfiler();
+				_profilerClock.restart();
+			}
+
+			_data->window.draw(_profilerText);
+		}
+#endif
+	}
+
+#if PROFILING
+	void HUD::UpdateProfiler()
+	{
+		std::ostringstream text;
+		text << std::fixed << std::setprecision(3);
+
+		for (ProfileZone* zone : Profiler::GetZones())
+		{
+			float p50, p99;
+			if (zone->GetPercentiles(p50, p99))
+				text << zone->GetName() << "  p50 " << p50 << "ms  p99 " << p99 << "ms\n";
+		}
+
+		_profilerText.setString(text.str());
 	}
+#endif
 
 	void HUD::UpdateScore(int score)
 	{
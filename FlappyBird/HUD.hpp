@@ -4,6 +4,7 @@
 
 #include "DEFINITIONS.hpp"
 #include "Game.hpp"
+#include "Profiler.hpp"
 
 namespace Sonar
 {
@@ -21,5 +22,18 @@ namespace Sonar
 
 		sf::Text _scoreText;
 
+		sf::Text _speedText;
+		int _shownSpeed;
+
+		sf::Text _cpuText;
+		int _shownCpu;
+
+#if PROFILING
+		sf::Text _profilerText;
+		sf::Clock _profilerClock;
+
+		void UpdateProfiler();
+#endif
+
 	};
 }
\ No newline at end of file
@@ -45,4 +45,17 @@ namespace Sonar
 	{
 		return _landSprites;
 	}
+
+	void Land::SaveState(StateWriter &out) const
+	{
+		for (const sf::Sprite &sprite : _landSprites)
+			out.Write(sprite.getPosition());
+	}
+
+	void Land::LoadState(StateReader &in)
+	{
+		// There are always the same two sprites, only where they are changes
+		for (sf::Sprite &sprite : _landSprites)
+			sprite.setPosition(in.Read<sf::Vector2f>());
+	}
 }
\ No newline at end of file
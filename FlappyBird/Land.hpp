@@ -2,6 +2,7 @@
 
 #include <SFML/Graphics.hpp>
 #include "Game.hpp"
+#include "StateStream.hpp"
 #include <vector>
 
 namespace Sonar
@@ -16,6 +17,9 @@ namespace Sonar
 
 		const std::vector<sf::Sprite> &GetSprites() const;
 
+		void SaveState(StateWriter &out) const;
+		void LoadState(StateReader &in);
+
 	private:
 		GameDataRef _data;
 
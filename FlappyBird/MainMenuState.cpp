@@ -28,22 +28,13 @@ namespace Sonar
 		_playButton.setPosition((SCREEN_WIDTH / 2) - (_playButton.getGlobalBounds().width / 2), (SCREEN_HEIGHT / 2) - (_playButton.getGlobalBounds().height / 2));
 	}
 
-	void MainMenuState::HandleInput()
+	void MainMenuState::HandleEvent(const sf::Event &event)
 	{
-		sf::Event event;
-
-		while (this->_data->window.pollEvent(event))
+		// Once per press rather than once per event while the button is held
+		if (sf::Event::MouseButtonPressed == event.type && this->_data->input.IsSpriteClicked(this->_playButton, sf::Mouse::Left, this->_data->window))
 		{
-			if (sf::Event::Closed == event.type)
-			{
-				this->_data->window.close();
-			}
-
-			if (this->_data->input.IsSpriteClicked(this->_playButton, sf::Mouse::Left, this->_data->window))
-			{
-				// Switch To Main Menu
-				this->_data->machine.AddState(StateRef(new GameState(_data)), true);
-			}
+			// Switch To Main Menu
+			this->_data->machine.AddState(StateRef(new GameState(_data)), true);
 		}
 	}
 
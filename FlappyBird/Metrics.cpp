@@ -0,0 +1,138 @@
+#include "Metrics.hpp"
+#include "AllocationCounter.hpp"
+#include "ProcessStats.hpp"
+
+#include <cstring>
+#include <vector>
+
+namespace Sonar
+{
+	namespace
+	{
+		struct Entry
+		{
+			const char *name;
+			const char *help;
+			const char *type;
+			const Counter *counter;
+			const Gauge *gauge;
+		};
+
+		// Filled in as the metrics below are constructed, before main runs and any thread can read it
+		std::vector<Entry> &GetEntries()
+		{
+			static std::vector<Entry> entries;
+			return entries;
+		}
+
+		unsigned int GetThreadSlot()
+		{
+			static std::atomic<unsigned int> nextSlot(0);
+			thread_local unsigned int slot = nextSlot.fetch_add(1, std::memory_order_relaxed) % METRICS_THREAD_SLOTS;
+			return slot;
+		}
+
+		// A name such as flappy_queue_depth{queue="snapshots"} belongs to the flappy_queue_depth family
+		std::string GetFamily(const char *name)
+		{
+			const char *labels = std::strchr(name, '{');
+			return labels != nullptr ? std::string(name, labels) : std::string(name);
+		}
+	}
+
+	Counter::Counter(const char *name, const char *help, bool isLevel)
+	{
+		for (Slot &slot : _slots)
+			slot.value.store(0, std::memory_order_relaxed);
+
+		GetEntries().push_back(Entry{ name, help, isLevel ? "gauge" : "counter", this, nullptr });
+	}
+
+	void Counter::Add(long long value)
+	{
+		_slots[GetThreadSlot()].value.fetch_add(value, std::memory_order_relaxed);
+	}
+
+	long long Counter::GetValue() const
+	{
+		long long total = 0;
+		for (const Slot &slot : _slots)
+			total += slot.value.load(std::memory_order_relaxed);
+		return total;
+	}
+
+	Gauge::Gauge(const char *name, const char *help) : _value(0.0)
+	{
+		GetEntries().push_back(Entry{ name, help, "gauge", nullptr, this });
+	}
+
+	namespace Metrics
+	{
+		Counter Ticks("flappy_ticks_total", "Simulation ticks played");
+		Counter Episodes("flappy_episodes_total", "Birds that have died or retired, each ending one chromosome's episode");
+		Gauge AliveBirds("flappy_alive_birds", "Birds still flying in the current episode");
+		Gauge TicksPerSecond("flappy_ticks_per_second", "Simulation ticks per wall clock second");
+		Gauge SimulationSpeed("flappy_simulation_speed", "Simulated seconds per wall clock second");
+
+		Gauge Generation("flappy_generation", "Generation being evaluated");
+		Gauge RacingStage("flappy_racing_stage", "Racing stage of the generation being evaluated");
+		Gauge BestScore("flappy_best_score", "Best score in the last completed generation");
+		Gauge MeanScore("flappy_mean_score", "Mean score in the last completed generation");
+		Gauge GenerationsPerHour("flappy_generations_per_hour", "Generations per hour, from how long the last one took");
+
+		Gauge SnapshotQueueDepth("flappy_queue_depth{queue=\"snapshots\"}", "Items waiting in each queue");
+		Counter TraceQueueDepth("flappy_queue_depth{queue=\"trace\"}", "Items waiting in each queue", true);
+		Gauge WriteQueueDepth("flappy_queue_depth{queue=\"writes\"}", "Items waiting in each queue");
+
+		void Write(std::ostream &out)
+		{
+			const std::vector<Entry> &entries = GetEntries();
+
+			// Prometheus wants a family's samples together, wherever they were declared
+			std::vector<bool> written(entries.size(), false);
+			for (size_t i = 0; i < entries.size(); i++)
+			{
+				if (written[i])
+					continue;
+
+				std::string family = GetFamily(entries[i].name);
+				out << "# HELP " << family << " " << entries[i].help << "\n";
+				out << "# TYPE " << family << " " << entries[i].type << "\n";
+
+				for (size_t j = i; j < entries.size(); j++)
+				{
+					if (written[j] || GetFamily(entries[j].name) != family)
+						continue;
+
+					out << entries[j].name << " ";
+					if (entries[j].counter != nullptr)
+						out << entries[j].counter->GetValue();
+					else
+						out << entries[j].gauge->GetValue();
+					out << "\n";
+
+					written[j] = true;
+				}
+			}
+
+			// Memory is read when scraped rather than kept up to date
+			out << "# HELP flappy_peak_resident_bytes Peak resident memory of the process\n";
+			out << "# TYPE flappy_peak_resident_bytes gauge\n";
+			out << "flappy_peak_resident_bytes " << ProcessStats::GetPeakResidentBytes() << "\n";
+
+#if ALLOCATION_HOOKS
+			out << "# HELP flappy_live_bytes Bytes allocated and not yet freed\n";
+			out << "# TYPE flappy_live_bytes gauge\n";
+			out << "flappy_live_bytes " << AllocationCounter::GetTotalStats().liveBytes << "\n";
+#endif
+#if MEMORY_ACCOUNTING
+			// These take the accounting's lock, which tagged allocations hold only briefly
+			out << "# HELP flappy_tagged_live_bytes Bytes allocated and not yet freed, by what they were allocated for\n";
+			out << "# TYPE flappy_tagged_live_bytes gauge\n";
+			for (int tag = 0; tag < (int)MemoryTag::Count; tag++)
+				out << "flappy_tagged_live_bytes{tag=\"" << AllocationCounter::GetTagName((MemoryTag)tag) << "\"} "
+					<< AllocationCounter::GetStats((MemoryTag)tag).liveBytes << "\n";
+#endif
+		}
+	}
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <atomic>
+#include <ostream>
+#include <string>
+
+#include "DEFINITIONS.hpp"
+
+#if METRICS_ENDPOINT
+// Metrics are the globals declared at the bottom of this file
+#define METRIC_ADD(metric, value) Sonar::Metrics::metric.Add(value)
+#define METRIC_SET(metric, value) Sonar::Metrics::metric.Set(value)
+#else
+#define METRIC_ADD(metric, value) ((void)0)
+#define METRIC_SET(metric, value) ((void)0)
+#endif
+
+namespace Sonar
+{
+	// Summed from one slot per thread, so adding to it is a single uncontended
+	// atomic add and reading it never waits on whoever is adding. Threads past
+	// METRICS_THREAD_SLOTS share slots, which is still correct, just contended.
+	class Counter
+	{
+	public:
+		// Levels go down as well as up, and are exported as gauges
+		Counter(const char *name, const char *help, bool isLevel = false);
+
+		void Add(long long value);
+		long long GetValue() const;
+
+	private:
+		struct Slot
+		{
+			std::atomic<long long> value;
+			// Keeps each slot on its own cache line
+			char padding[64 - sizeof(std::atomic<long long>)];
+		};
+
+		Slot _slots[METRICS_THREAD_SLOTS];
+	};
+
+	// The last value set, for things one thread measures now and then
+	class Gauge
+	{
+	public:
+		Gauge(const char *name, const char *help);
+
+		void Set(double value) { _value.store(value, std::memory_order_relaxed); }
+		double GetValue() const { return _value.load(std::memory_order_relaxed); }
+
+	private:
+		std::atomic<double> _value;
+	};
+
+	namespace Metrics
+	{
+		// Every metric in the Prometheus text format. Only reads atomics, so it
+		// can be called from any thread while the simulation runs
+		void Write(std::ostream &out);
+
+		extern Counter Ticks;
+		extern Counter Episodes;
+		extern Gauge AliveBirds;
+		extern Gauge TicksPerSecond;
+		extern Gauge SimulationSpeed;
+
+		extern Gauge Generation;
+		extern Gauge RacingStage;
+		extern Gauge BestScore;
+		extern Gauge MeanScore;
+		extern Gauge GenerationsPerHour;
+
+		extern Gauge SnapshotQueueDepth;
+		extern Counter TraceQueueDepth;
+		extern Gauge WriteQueueDepth;
+	}
+}
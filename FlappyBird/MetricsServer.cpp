@@ -0,0 +1,89 @@
+#include "MetricsServer.hpp"
+#include "Metrics.hpp"
+#include "TraceRecorder.hpp"
+
+#include <SFML/Network.hpp>
+
+#include <iostream>
+#include <sstream>
+
+namespace Sonar
+{
+	std::atomic<bool> MetricsServer::s_running(false);
+	std::thread MetricsServer::s_thread;
+
+	void MetricsServer::Start(unsigned short port)
+	{
+		if (s_thread.joinable())
+			return;
+
+		s_running = true;
+		s_thread = std::thread(Serve, port);
+	}
+
+	void MetricsServer::Stop()
+	{
+		s_running = false;
+
+		// Also joins a thread that gave up because it couldn't listen
+		if (s_thread.joinable())
+			s_thread.join();
+	}
+
+	void MetricsServer::Serve(unsigned short port)
+	{
+#if TRACING
+		TraceRecorder::SetThreadName("Metrics");
+#endif
+
+		sf::TcpListener listener;
+		if (listener.listen(port, sf::IpAddress::LocalHost) != sf::Socket::Done)
+		{
+			std::cout << "Error Listening For Metrics On Port " << port << std::endl;
+			s_running = false;
+			return;
+		}
+
+		std::cout << "Serving Metrics On http://localhost:" << port << "/metrics" << std::endl;
+
+		sf::SocketSelector selector;
+		selector.add(listener);
+
+		while (s_running)
+		{
+			// Wake up now and then to see if it's time to stop
+			if (!selector.wait(sf::milliseconds(250)))
+				continue;
+
+			sf::TcpSocket client;
+			if (listener.accept(client) != sf::Socket::Done)
+				continue;
+
+			// Whatever was asked for, the answer is the same, so the request only needs reading to be polite.
+			// Don't wait long for it though, a client that never sends one would stop Stop returning.
+			sf::SocketSelector requestSelector;
+			requestSelector.add(client);
+			if (requestSelector.wait(sf::seconds(1)))
+			{
+				char request[1024];
+				std::size_t received;
+				client.receive(request, sizeof(request), received);
+			}
+
+			std::ostringstream body;
+			Metrics::Write(body);
+			std::string content = body.str();
+
+			std::ostringstream response;
+			response << "HTTP/1.0 200 OK\r\n"
+				<< "Content-Type: text/plain; version=0.0.4\r\n"
+				<< "Content-Length: " << content.size() << "\r\n"
+				<< "Connection: close\r\n\r\n"
+				<< content;
+
+			std::string responseText = response.str();
+			client.send(responseText.data(), responseText.size());
+			client.disconnect();
+		}
+	}
+}
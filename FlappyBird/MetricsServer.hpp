@@ -0,0 +1,23 @@
+#pragma once
+
+#include <atomic>
+#include <thread>
+
+namespace Sonar
+{
+	// Answers every HTTP request on localhost:port with Metrics::Write, for
+	// Prometheus to scrape. Runs on its own thread and only reads the metrics,
+	// so a slow or stuck scraper never holds up the game.
+	class MetricsServer
+	{
+	public:
+		static void Start(unsigned short port);
+		static void Stop();
+
+	private:
+		static std::atomic<bool> s_running;
+		static std::thread s_thread;
+
+		static void Serve(unsigned short port);
+	};
+}
@@ -1,39 +1,30 @@
 #include "NeuralNetwork.h"
 #include "DEFINITIONS.hpp"
+#include "AllocationCounter.hpp"
+#include "GenerationFile.h"
 
-NeuralNetwork::NeuralNetwork(json networkJSON)
+NeuralNetwork::NeuralNetwork(const float* genes)
 {
+	MEMORY_TAG(AI);
+
 	for (int layer = 0; layer < HIDDEN_LAYER_COUNT; layer++)
 	{
-		json layerJSON = networkJSON[JSON_LAYER + std::to_string(layer)];
-
 		std::vector<Neuron*> layerNeurons;
 
 		for (int neuron = 0; neuron < NEURONS_PER_HIDDEN_LAYER; neuron++)
 		{
-			json neuronJSON = layerJSON[JSON_NEURON + std::to_string(neuron)];
-
-			std::vector<float> weights;
-			for (float weight : neuronJSON[JSON_WEIGHTS])
-				weights.push_back(weight);
+			const float* neuronGenes = genes + GenerationFile::GetNeuronOffset(layer, neuron);
+			int weightCount = GenerationFile::GetWeightCount(layer);
 
-			float bias = neuronJSON[JSON_BIAS];
-
-			layerNeurons.push_back(new Neuron(weights, bias));
+			layerNeurons.push_back(new Neuron(std::vector<float>(neuronGenes, neuronGenes + weightCount), neuronGenes[weightCount]));
 		}
 
 		_hiddenLayers.push_back(layerNeurons);
 	}
 
-	json outputJSON = networkJSON[JSON_OUTPUT];
-
-	std::vector<float> weights;
-	for (float weight : outputJSON[JSON_WEIGHTS])
-		weights.push_back(weight);
-
-	float bias = outputJSON[JSON_BIAS];
+	const float* outputGenes = genes + GenerationFile::GetOutputOffset();
 
-	_output = new Neuron(weights, bias);
+	_output = new Neuron(std::vector<float>(outputGenes, outputGenes + NEURONS_PER_HIDDEN_LAYER), outputGenes[NEURONS_PER_HIDDEN_LAYER]);
 }
 
 NeuralNetwork::~NeuralNetwork()
@@ -45,16 +36,23 @@ NeuralNetwork::~NeuralNetwork()
 	delete _output;
 }
 
-float NeuralNetwork::Calculate(std::vector<float> inputs, int layer)
+float NeuralNetwork::Calculate(const float *inputs) const
 {
-	if (layer >= HIDDEN_LAYER_COUNT)
-		return _output->Calculate(inputs);
+	// Wide enough for any layer's inputs or outputs
+	const int layerWidth = INPUT_COUNT > NEURONS_PER_HIDDEN_LAYER ? INPUT_COUNT : NEURONS_PER_HIDDEN_LAYER;
+	float values[2][layerWidth];
 
-	std::vector<float> outputs;
+	// Each layer reads the last layer's outputs and writes into the other half
+	const float* layerInputs = inputs;
+	for (int layer = 0; layer < _hiddenLayers.size(); layer++)
+	{
+		float* outputs = values[layer % 2];
 
-	//for (int layer = 0; layer < _hiddenLayers.size(); layer++)
-	for (int neuron = 0; neuron < _hiddenLayers[layer].size(); neuron++)
-		outputs.push_back(_hiddenLayers[layer][neuron]->Calculate(inputs));
+		for (int neuron = 0; neuron < _hiddenLayers[layer].size(); neuron++)
+			outputs[neuron] = _hiddenLayers[layer][neuron]->Calculate(layerInputs);
+
+		layerInputs = outputs;
+	}
 
-	return Calculate(outputs, layer + 1);
+	return _output->Calculate(layerInputs);
 }
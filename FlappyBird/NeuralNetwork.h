@@ -3,18 +3,16 @@
 #include "Neuron.h"
 
 #include <vector>
-#include <nlohmann/json.hpp>
-
-using json = nlohmann::json;
 
 class NeuralNetwork
 {
 public:
-	// Create Neural Network from JSON
-	NeuralNetwork(json json);
+	// Create Neural Network from a chromosome's GENOME_SIZE genes
+	NeuralNetwork(const float* genes);
 	~NeuralNetwork();
 
-	float Calculate(std::vector<float> inputs, int layer);
+	// Takes INPUT_COUNT inputs, and works entirely on the stack
+	float Calculate(const float *inputs) const;
 private:
 	std::vector<std::vector<Neuron*>> _hiddenLayers;
 	Neuron* _output;
@@ -7,17 +7,17 @@ Neuron::Neuron(std::vector<float> weights, float bias)
 	_bias = bias;
 }
 
-float Neuron::Calculate(std::vector<float> inputs)
+float Neuron::Calculate(const float *inputs) const
 {
 	float sum = 0;
-	for (int i = 0; i < inputs.size(); i++)
+	for (int i = 0; i < _weights.size(); i++)
 		sum += _weights[i] * inputs[i];
 
 	return Activate(sum + _bias);
 }
 
 // Sign activation function (is the number positive or not)
-float Neuron::Activate(float sum)
+float Neuron::Activate(float sum) const
 {
 	if (sum < 0.0f)
 		return -1.0f;
@@ -6,10 +6,11 @@ class Neuron
 public:
 	Neuron(std::vector<float> weights, float bias);
 
-	float Calculate(std::vector<float> inputs);
+	// inputs holds one value per weight
+	float Calculate(const float *inputs) const;
 private:
 	std::vector<float> _weights;
 	float _bias;
 
-	float Activate(float sum);
+	float Activate(float sum) const;
 };
\ No newline at end of file
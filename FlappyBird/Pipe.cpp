@@ -8,40 +8,58 @@ namespace Sonar
 	Pipe::Pipe(GameDataRef data) : _data(data)
 	{
 		_landHeight = this->_data->assets.GetTexture("Land").getSize().y;
+
+		// Look the textures up once here rather than by name on every spawn
+		_pipeUpTexture = &this->_data->assets.GetTexture("Pipe Up");
+		_pipeDownTexture = &this->_data->assets.GetTexture("Pipe Down");
+		_scoringPipeTexture = &this->_data->assets.GetTexture("Scoring Pipe");
 		_pipeSpawnYOffset = 0;
+
+		_course = this->_data->course;
+		_pipeIndex = 0;
+		_nextSpriteId = 0;
+
+		// Room for every pipe that can be on screen at once, so spawning never has to grow these
+		unsigned int setsOnScreen = (unsigned int)(this->_data->window.getSize().x / (PIPE_MOVEMENT_SPEED * PIPE_SPAWN_FREQUENCY)) + 2;
+		pipeSprites.reserve(setsOnScreen * 3);
+		pipeSpriteIds.reserve(setsOnScreen * 3);
+		scoringPipes.reserve(setsOnScreen);
 	}
 
 	void Pipe::SpawnBottomPipe()
 	{
-		sf::Sprite sprite(this->_data->assets.GetTexture("Pipe Up"));
+		sf::Sprite sprite(*_pipeUpTexture);
 
 		sprite.setPosition((float)this->_data->window.getSize().x, (float)this->_data->window.getSize().y - sprite.getLocalBounds().height - _pipeSpawnYOffset);
 
 		pipeSprites.push_back(sprite);
+		pipeSpriteIds.push_back(_nextSpriteId++);
 	}
 
 	void Pipe::SpawnTopPipe()
 	{
-		sf::Sprite sprite(this->_data->assets.GetTexture("Pipe Down"));
+		sf::Sprite sprite(*_pipeDownTexture);
 
 		sprite.setPosition((float)this->_data->window.getSize().x, (float)-_pipeSpawnYOffset);
 
 		pipeSprites.push_back(sprite);
+		pipeSpriteIds.push_back(_nextSpriteId++);
 	}
 
 	void Pipe::SpawnInvisiblePipe()
 	{
-		sf::Sprite sprite(this->_data->assets.GetTexture("Pipe Down"));
+		sf::Sprite sprite(*_pipeDownTexture);
 
 		sprite.setPosition((float)this->_data->window.getSize().x, (float)-_pipeSpawnYOffset);
 		sprite.setColor(sf::Color(0, 0, 0, 0));
 
 		pipeSprites.push_back(sprite);
+		pipeSpriteIds.push_back(_nextSpriteId++);
 	}
 
 	void Pipe::SpawnScoringPipe()
 	{
-		sf::Sprite sprite(this->_data->assets.GetTexture("Scoring Pipe"));
+		sf::Sprite sprite(*_scoringPipeTexture);
 
 		sprite.setPosition((float)this->_data->window.getSize().x, 0);
 
@@ -55,6 +73,7 @@ namespace Sonar
 			if (pipeSprites.at(i).getPosition().x < 0 - pipeSprites.at(i).getLocalBounds().width)
 			{
 				pipeSprites.erase( pipeSprites.begin( ) + i );
+				pipeSpriteIds.erase(pipeSpriteIds.begin() + i);
 			}
 			else
 			{
@@ -89,9 +108,114 @@ namespace Sonar
 		}
 	}
 
-	void Pipe::RandomisePipeOffset()
+	void Pipe::SaveState(StateWriter &out) const
+	{
+		out.Write(_pipeSpawnYOffset);
+		out.Write(_pipeIndex);
+		out.Write(_nextSpriteId);
+
+		out.Write((unsigned int)pipeSprites.size());
+		for (unsigned int i = 0; i < pipeSprites.size(); i++)
+		{
+			out.Write(pipeSpriteIds[i]);
+			out.Write(GetSpriteKind(i));
+			out.Write(pipeSprites[i].getPosition());
+		}
+
+		out.Write((unsigned int)scoringPipes.size());
+		for (const sf::Sprite &sprite : scoringPipes)
+			out.Write(sprite.getPosition());
+	}
+
+	void Pipe::LoadState(StateReader &in)
+	{
+		_pipeSpawnYOffset = in.Read<int>();
+		_pipeIndex = in.Read<unsigned int>();
+		_nextSpriteId = in.Read<unsigned int>();
+
+		pipeSprites.clear();
+		pipeSpriteIds.clear();
+		unsigned int pipeCount = in.Read<unsigned int>();
+		for (unsigned int i = 0; i < pipeCount && in.IsValid(); i++)
+		{
+			unsigned int id = in.Read<unsigned int>();
+			int kind = in.Read<int>();
+
+			sf::Sprite sprite(PIPE_KIND_UP == kind ? *_pipeUpTexture : *_pipeDownTexture);
+			sprite.setPosition(in.Read<sf::Vector2f>());
+			if (PIPE_KIND_INVISIBLE == kind)
+				sprite.setColor(sf::Color(0, 0, 0, 0));
+
+			pipeSprites.push_back(sprite);
+			pipeSpriteIds.push_back(id);
+		}
+
+		scoringPipes.clear();
+		unsigned int scoringCount = in.Read<unsigned int>();
+		for (unsigned int i = 0; i < scoringCount && in.IsValid(); i++)
+		{
+			sf::Sprite sprite(*_scoringPipeTexture);
+			sprite.setPosition(in.Read<sf::Vector2f>());
+
+			scoringPipes.push_back(sprite);
+		}
+	}
+
+	void Pipe::NextPipeOffset()
+	{
+		_pipeSpawnYOffset = _course->GetOffset(_pipeIndex);
+		_pipeIndex++;
+	}
+
+	int Pipe::GetSpriteKind(unsigned int index) const
 	{
-		_pipeSpawnYOffset = rand() % (_landHeight + 1);
+		// They differ only in texture and colour
+		if (pipeSprites[index].getColor().a == 0)
+			return PIPE_KIND_INVISIBLE;
+
+		return pipeSprites[index].getTexture() == _pipeUpTexture ? PIPE_KIND_UP : PIPE_KIND_DOWN;
+	}
+
+	const sf::Texture &Pipe::GetKindTexture(int kind) const
+	{
+		return PIPE_KIND_UP == kind ? *_pipeUpTexture : *_pipeDownTexture;
+	}
+
+	bool Pipe::GetNextGapCentre(const std::vector<sf::Sprite> &pipeSprites, float x, float &centre)
+	{
+		const sf::Sprite* top = nullptr;
+		const sf::Sprite* bottom = nullptr;
+
+		for (const sf::Sprite &sprite : pipeSprites)
+		{
+			// Skip the invisible copies of the top pipes and anything already passed
+			if (sprite.getColor().a == 0 || sprite.getPosition().x + sprite.getLocalBounds().width < x)
+				continue;
+
+			if (top != nullptr && sprite.getPosition().x > top->getPosition().x)
+				continue;
+
+			if (top == nullptr || sprite.getPosition().x < top->getPosition().x)
+			{
+				top = &sprite;
+				bottom = nullptr;
+			}
+			else if (sprite.getPosition().y < top->getPosition().y)
+			{
+				bottom = top;
+				top = &sprite;
+			}
+			else
+			{
+				bottom = &sprite;
+			}
+		}
+
+		if (top == nullptr || bottom == nullptr)
+			return false;
+
+		centre = (top->getGlobalBounds().top + top->getGlobalBounds().height + bottom->getGlobalBounds().top) / 2;
+		return true;
 	}
 
 	const std::vector<sf::Sprite> &Pipe::GetSprites() const
@@ -99,6 +223,11 @@ namespace Sonar
 		return pipeSprites;
 	}
 
+	const std::vector<unsigned int> &Pipe::GetSpriteIds() const
+	{
+		return pipeSpriteIds;
+	}
+
 	std::vector<sf::Sprite> &Pipe::GetScoringSprites()
 	{
 		return scoringPipes;
@@ -2,8 +2,13 @@
 
 #include <SFML/Graphics.hpp>
 #include "Game.hpp"
+#include "StateStream.hpp"
 #include <vector>
 
+#define PIPE_KIND_UP 0
+#define PIPE_KIND_DOWN 1
+#define PIPE_KIND_INVISIBLE 2
+
 namespace Sonar
 {
 	class Pipe
@@ -17,18 +22,42 @@ namespace Sonar
 		void SpawnScoringPipe();
 		void MovePipes(float dt);
 		void DrawPipes();
-		void RandomisePipeOffset();
+		void NextPipeOffset();
 
 		const std::vector<sf::Sprite> &GetSprites() const;
+		// Unique per sprite for the life of the Pipe, in the same order as GetSprites
+		const std::vector<unsigned int> &GetSpriteIds() const;
 		std::vector<sf::Sprite> &GetScoringSprites();
+		// One of the PIPE_KINDs, and the texture each is drawn with
+		int GetSpriteKind(unsigned int index) const;
+		const sf::Texture &GetKindTexture(int kind) const;
+		unsigned int GetSpriteCapacity() const { return (unsigned int)pipeSprites.capacity(); }
+
+		unsigned int GetPipeIndex() const { return _pipeIndex; }
+
+		void SaveState(StateWriter &out) const;
+		// Rebuilds every sprite, within the capacity reserved up front
+		void LoadState(StateReader &in);
+
+		// Height of the middle of the first gap in pipeSprites still ahead of x, false if there isn't one
+		static bool GetNextGapCentre(const std::vector<sf::Sprite> &pipeSprites, float x, float &centre);
 
 	private:
 		GameDataRef _data;
 		std::vector<sf::Sprite> pipeSprites;
 		std::vector<sf::Sprite> scoringPipes;
+		std::vector<unsigned int> pipeSpriteIds;
+		unsigned int _nextSpriteId;
 
 		int _landHeight;
 		int _pipeSpawnYOffset;
 
+		const sf::Texture *_pipeUpTexture;
+		const sf::Texture *_pipeDownTexture;
+		const sf::Texture *_scoringPipeTexture;
+
+		CourseRef _course;
+		unsigned int _pipeIndex;
+
 	};
 }
\ No newline at end of file
@@ -0,0 +1,61 @@
+#include "ProcessStats.hpp"
+
+#include <ctime>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+namespace Sonar
+{
+	namespace ProcessStats
+	{
+		double GetCpuTime()
+		{
+#ifdef _WIN32
+			// clock() is wall time on Windows, so ask for the process times directly
+			FILETIME creation, exit, kernel, user;
+			if (!GetProcessTimes(GetCurrentProcess(), &creation, &exit, &kernel, &user))
+				return 0.0;
+
+			ULARGE_INTEGER kernelTime, userTime;
+			kernelTime.LowPart = kernel.dwLowDateTime;
+			kernelTime.HighPart = kernel.dwHighDateTime;
+			userTime.LowPart = user.dwLowDateTime;
+			userTime.HighPart = user.dwHighDateTime;
+
+			// In 100 nanosecond ticks
+			return (kernelTime.QuadPart + userTime.QuadPart) / 10000000.0;
+#else
+			return (double)std::clock() / CLOCKS_PER_SEC;
+#endif
+		}
+
+		std::size_t GetPeakResidentBytes()
+		{
+#ifdef _WIN32
+			PROCESS_MEMORY_COUNTERS counters;
+			if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+				return 0;
+
+			return counters.PeakWorkingSetSize;
+#else
+			struct rusage usage;
+			if (getrusage(RUSAGE_SELF, &usage) != 0)
+				return 0;
+
+#ifdef __APPLE__
+			return (std::size_t)usage.ru_maxrss;
+#else
+			// Linux reports kilobytes
+			return (std::size_t)usage.ru_maxrss * 1024;
+#endif
+#endif
+		}
+	}
+}
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <cstddef>
+
+namespace Sonar
+{
+	// What the operating system says this process has used so far
+	namespace ProcessStats
+	{
+		// Seconds of CPU time, across every thread
+		double GetCpuTime();
+
+		// Most physical memory the process has held at once, in bytes
+		std::size_t GetPeakResidentBytes();
+	}
+}
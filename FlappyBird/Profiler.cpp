@@ -0,0 +1,79 @@
+#include "Profiler.hpp"
+#include "AllocationCounter.hpp"
+
+#include <algorithm>
+
+namespace Sonar
+{
+	std::mutex Profiler::s_mutex;
+	std::vector<std::unique_ptr<ProfileZone>> Profiler::s_zones;
+
+	ProfileZone::ProfileZone(const std::string &name) : _name(name), _recorded(0)
+	{
+		for (std::atomic<float> &sample : _samples)
+			sample.store(0.0f, std::memory_order_relaxed);
+	}
+
+	void ProfileZone::Record(float milliseconds)
+	{
+		unsigned int index = _recorded.load(std::memory_order_relaxed);
+
+		_samples[index % PROFILER_HISTORY].store(milliseconds, std::memory_order_relaxed);
+		_recorded.store(index + 1, std::memory_order_release);
+	}
+
+	std::chrono::steady_clock::time_point ProfileTimer::Record(ProfileZone &zone, std::chrono::steady_clock::time_point start)
+	{
+		std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+
+		zone.Record(std::chrono::duration<float, std::milli>(end - start).count());
+#if TRACING
+		TraceRecorder::Complete(zone.GetName().c_str(), start, end);
+#endif
+
+		return end;
+	}
+
+	bool ProfileZone::GetPercentiles(float &p50, float &p99) const
+	{
+		unsigned int count = std::min(_recorded.load(std::memory_order_acquire), (unsigned int)PROFILER_HISTORY);
+		if (count == 0)
+			return false;
+
+		float sorted[PROFILER_HISTORY];
+		for (unsigned int i = 0; i < count; i++)
+			sorted[i] = _samples[i].load(std::memory_order_relaxed);
+
+		std::sort(sorted, sorted + count);
+
+		p50 = sorted[(count - 1) / 2];
+		p99 = sorted[(count - 1) * 99 / 100];
+
+		return true;
+	}
+
+	ProfileZone &Profiler::GetZone(const std::string &name)
+	{
+		MEMORY_TAG(Logging);
+
+		std::lock_guard<std::mutex> lock(s_mutex);
+
+		for (std::unique_ptr<ProfileZone> &zone : s_zones)
+			if (zone->GetName() == name)
+				return *zone;
+
+		s_zones.push_back(std::unique_ptr<ProfileZone>(new ProfileZone(name)));
+		return *s_zones.back();
+	}
+
+	std::vector<ProfileZone*> Profiler::GetZones()
+	{
+		std::lock_guard<std::mutex> lock(s_mutex);
+
+		std::vector<ProfileZone*> zones;
+		for (std::unique_ptr<ProfileZone> &zone : s_zones)
+			zones.push_back(zone.get());
+
+		return zones;
+	}
+}
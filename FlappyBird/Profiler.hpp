@@ -0,0 +1,85 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <memory>
+
+#include "DEFINITIONS.hpp"
+#include "TraceRecorder.hpp"
+
+#if PROFILING || TRACING
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+// Times the rest of the enclosing scope under name. The zone is looked up once per call site.
+#define PROFILE_SCOPE(name) \
+	static Sonar::ProfileZone &PROFILE_CONCAT(_profileZone, __LINE__) = Sonar::Profiler::GetZone(name); \
+	Sonar::ProfileTimer PROFILE_CONCAT(_profileTimer, __LINE__)(PROFILE_CONCAT(_profileZone, __LINE__))
+// For code that runs in phases without a scope each. PROFILE_PHASES starts
+// timing, then each PROFILE_PHASE ends one phase and starts the next.
+#define PROFILE_PHASES() std::chrono::steady_clock::time_point _profilePhaseStart = std::chrono::steady_clock::now()
+#define PROFILE_PHASE_RESTART() _profilePhaseStart = std::chrono::steady_clock::now()
+#define PROFILE_PHASE(name) do { \
+	static Sonar::ProfileZone &_profilePhaseZone = Sonar::Profiler::GetZone(name); \
+	_profilePhaseStart = Sonar::ProfileTimer::Record(_profilePhaseZone, _profilePhaseStart); \
+	} while (0)
+#else
+#define PROFILE_SCOPE(name)
+#define PROFILE_PHASES()
+#define PROFILE_PHASE_RESTART()
+#define PROFILE_PHASE(name)
+#endif
+
+namespace Sonar
+{
+	// The last PROFILER_HISTORY times taken by one zone. Written by whichever
+	// thread runs the zone and read by the overlay, so samples are atomics
+	// rather than locked.
+	class ProfileZone
+	{
+	public:
+		ProfileZone(const std::string &name);
+
+		const std::string &GetName() const { return _name; }
+
+		void Record(float milliseconds);
+		// False if nothing has been recorded yet
+		bool GetPercentiles(float &p50, float &p99) const;
+
+	private:
+		std::string _name;
+
+		std::atomic<float> _samples[PROFILER_HISTORY];
+		std::atomic<unsigned int> _recorded;
+	};
+
+	class ProfileTimer
+	{
+	public:
+		ProfileTimer(ProfileZone &zone) : _zone(zone), _start(std::chrono::steady_clock::now()) { }
+		~ProfileTimer() { Record(_zone, _start); }
+
+		// Records from start until now into zone and the trace, returning now
+		static std::chrono::steady_clock::time_point Record(ProfileZone &zone, std::chrono::steady_clock::time_point start);
+
+	private:
+		ProfileZone &_zone;
+		std::chrono::steady_clock::time_point _start;
+	};
+
+	class Profiler
+	{
+	public:
+		// Zones live until the program exits, so references to them never go stale
+		static ProfileZone &GetZone(const std::string &name);
+
+		// Every zone so far, in the order they were first hit
+		static std::vector<ProfileZone*> GetZones();
+
+	private:
+		static std::mutex s_mutex;
+		static std::vector<std::unique_ptr<ProfileZone>> s_zones;
+	};
+}
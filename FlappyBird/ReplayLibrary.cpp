@@ -0,0 +1,291 @@
+#include "ReplayLibrary.hpp"
+#include "DEFINITIONS.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+namespace Sonar
+{
+	ReplayLibrary::ReplayLibrary() : _uses(0), _running(true)
+	{
+		_thread = std::thread(&ReplayLibrary::PrefetchLoop, this);
+	}
+
+	ReplayLibrary::~ReplayLibrary()
+	{
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			_running = false;
+		}
+
+		_wake.notify_all();
+		_thread.join();
+	}
+
+	bool ReplayLibrary::Open(const std::string &indexFilePath, const std::string &historyFilePath)
+	{
+		std::ifstream f(indexFilePath);
+		if (!f.good())
+		{
+			std::cout << "Error Opening Replay Index " << indexFilePath << std::endl;
+			return false;
+		}
+
+		std::vector<Entry> entries;
+		std::string line;
+		unsigned int lineNum = 1;
+
+		// Skip the header
+		std::getline(f, line);
+
+		while (std::getline(f, line))
+		{
+			std::istringstream fields(line);
+			Entry entry;
+			entry.line = lineNum++;
+			unsigned int ticks;
+			char separators[3];
+
+			// A line the trainer is still writing is skipped, the next Open will get it
+			if (!(fields >> entry.generation >> separators[0] >> entry.stage >> separators[1] >> ticks >> separators[2])
+				|| separators[0] != ',' || separators[1] != ',' || separators[2] != ',' || !std::getline(fields, entry.filePath))
+				continue;
+
+			entries.push_back(entry);
+		}
+
+		// Keep the last stage of each generation, and of those the last one saved, as a resumed stage saves again
+		std::stable_sort(entries.begin(), entries.end(), [](const Entry &a, const Entry &b)
+		{
+			return a.generation < b.generation || (a.generation == b.generation && a.stage < b.stage);
+		});
+
+		std::vector<Entry> latest;
+		for (const Entry &entry : entries)
+		{
+			if (!latest.empty() && latest.back().generation == entry.generation)
+				latest.back() = entry;
+			else
+				latest.push_back(entry);
+		}
+
+		GenomeHistory history;
+		history.Open(historyFilePath);
+
+		std::lock_guard<std::mutex> lock(_mutex);
+
+		_entries.swap(latest);
+		std::swap(_history, history);
+
+		return !_entries.empty();
+	}
+
+	void ReplayLibrary::AddToIndex(const std::string &indexFilePath, int generation, int stage, unsigned int ticks, const std::string &replayFilePath)
+	{
+		bool writeHeader = !std::ifstream(indexFilePath).good();
+
+		std::ofstream o(indexFilePath, std::ios::out | std::ios::app);
+
+		if (writeHeader)
+			o << GetIndexHeader();
+
+		o << GetIndexLine(generation, stage, ticks, replayFilePath);
+	}
+
+	std::string ReplayLibrary::GetIndexLine(int generation, int stage, unsigned int ticks, const std::string &replayFilePath)
+	{
+		return std::to_string(generation) + "," + std::to_string(stage) + "," + std::to_string(ticks) + "," + replayFilePath + "\n";
+	}
+
+	std::shared_ptr<const Generation> ReplayLibrary::RebuildGeneration(int generation)
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+
+		return _history.Rebuild(generation);
+	}
+
+	std::vector<std::string> ReplayLibrary::ListFiles(const std::string &indexFilePath)
+	{
+		std::vector<std::string> files;
+
+		std::ifstream f(indexFilePath);
+		std::string line;
+
+		// Skip the header
+		std::getline(f, line);
+
+		while (std::getline(f, line))
+		{
+			std::istringstream fields(line);
+			int generation, stage;
+			unsigned int ticks;
+			char separators[3];
+			std::string filePath;
+
+			if ((fields >> generation >> separators[0] >> stage >> separators[1] >> ticks >> separators[2])
+				&& separators[0] == ',' && separators[1] == ',' && separators[2] == ',' && std::getline(fields, filePath))
+				files.push_back(filePath);
+		}
+
+		return files;
+	}
+
+	unsigned int ReplayLibrary::GetCount()
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+
+		return (unsigned int)_entries.size();
+	}
+
+	int ReplayLibrary::GetGeneration(unsigned int entry)
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+
+		return entry < _entries.size() ? _entries[entry].generation : -1;
+	}
+
+	unsigned int ReplayLibrary::Find(int generation)
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+
+		std::vector<Entry>::const_iterator after = std::upper_bound(_entries.begin(), _entries.end(), generation,
+			[](int generation, const Entry &entry) { return generation < entry.generation; });
+
+		return after == _entries.begin() ? 0 : (unsigned int)(after - _entries.begin() - 1);
+	}
+
+	std::shared_ptr<const ReplayRecording> ReplayLibrary::Get(unsigned int entry)
+	{
+		std::unique_lock<std::mutex> lock(_mutex);
+
+		if (entry >= _entries.size())
+			return nullptr;
+
+		Entry found = _entries[entry];
+
+		// Rather than load it twice, wait for the prefetch that's already under way
+		_loaded.wait(lock, [this, &found]() { return _loading != found.filePath; });
+
+		std::shared_ptr<const ReplayRecording> recording;
+		if (FindCached(found, recording))
+			return recording;
+
+		lock.unlock();
+		recording = Load(found.filePath);
+		lock.lock();
+
+		AddToCache(found, recording);
+
+		return recording;
+	}
+
+	void ReplayLibrary::Prefetch(unsigned int entry)
+	{
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+
+			// Nearest first, and next before previous as watching usually goes forwards
+			_prefetchQueue.clear();
+			for (unsigned int distance = 1; distance <= REPLAY_PREFETCH_RADIUS; distance++)
+			{
+				if (entry + distance < _entries.size())
+					_prefetchQueue.push_back(entry + distance);
+				if (entry >= distance)
+					_prefetchQueue.push_back(entry - distance);
+			}
+		}
+
+		_wake.notify_one();
+	}
+
+	bool ReplayLibrary::FindCached(const Entry &entry, std::shared_ptr<const ReplayRecording> &recording)
+	{
+		for (CachedRecording &cached : _cache)
+		{
+			if (cached.filePath != entry.filePath || cached.line != entry.line)
+				continue;
+
+			cached.lastUsed = ++_uses;
+			recording = cached.recording;
+			return true;
+		}
+
+		return false;
+	}
+
+	void ReplayLibrary::AddToCache(const Entry &entry, std::shared_ptr<const ReplayRecording> recording)
+	{
+		std::shared_ptr<const ReplayRecording> existing;
+		if (FindCached(entry, existing))
+			return;
+
+		// An older save of the same file is never going to be asked for again
+		for (CachedRecording &cached : _cache)
+		{
+			if (cached.filePath != entry.filePath)
+				continue;
+
+			cached = CachedRecording{ entry.filePath, entry.line, recording, ++_uses };
+			return;
+		}
+
+		if (_cache.size() < REPLAY_CACHE_SIZE)
+		{
+			_cache.push_back(CachedRecording{ entry.filePath, entry.line, recording, ++_uses });
+			return;
+		}
+
+		// Whoever is still playing the evicted recording keeps it alive until they're done with it
+		std::vector<CachedRecording>::iterator oldest = std::min_element(_cache.begin(), _cache.end(),
+			[](const CachedRecording &a, const CachedRecording &b) { return a.lastUsed < b.lastUsed; });
+
+		*oldest = CachedRecording{ entry.filePath, entry.line, recording, ++_uses };
+	}
+
+	void ReplayLibrary::PrefetchLoop()
+	{
+		std::unique_lock<std::mutex> lock(_mutex);
+
+		while (true)
+		{
+			_wake.wait(lock, [this]() { return !_running || !_prefetchQueue.empty(); });
+
+			if (!_running)
+				return;
+
+			unsigned int entry = _prefetchQueue.front();
+			_prefetchQueue.pop_front();
+
+			if (entry >= _entries.size())
+				continue;
+
+			std::shared_ptr<const ReplayRecording> recording;
+			if (FindCached(_entries[entry], recording))
+				continue;
+
+			// Copied, as Open can replace the entries while it loads
+			Entry loading = _entries[entry];
+			_loading = loading.filePath;
+
+			lock.unlock();
+			recording = Load(loading.filePath);
+			lock.lock();
+
+			AddToCache(loading, recording);
+			_loading.clear();
+			_loaded.notify_all();
+		}
+	}
+
+	std::shared_ptr<const ReplayRecording> ReplayLibrary::Load(const std::string &filePath)
+	{
+		std::shared_ptr<ReplayRecording> recording = std::make_shared<ReplayRecording>();
+
+		if (!recording->Load(filePath))
+			return nullptr;
+
+		return recording;
+	}
+}
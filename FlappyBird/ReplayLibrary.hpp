@@ -0,0 +1,97 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ReplayRecording.hpp"
+#include "GenomeHistory.h"
+
+namespace Sonar
+{
+	// Every generation's replay, found through the index the trainer appends to
+	// as it saves them. Recordings are loaded when first asked for and kept in
+	// an LRU cache of REPLAY_CACHE_SIZE, and a background thread loads the
+	// generations either side of the one being watched, so stepping to a
+	// neighbour finds it already loaded.
+	class ReplayLibrary
+	{
+	public:
+		ReplayLibrary();
+		~ReplayLibrary();
+
+		// Reads the index, again to pick up what a running trainer has added since. False if it's empty.
+		// The genome history is reopened with it, if there is one
+		bool Open(const std::string &indexFilePath, const std::string &historyFilePath);
+
+		// Called by the trainer for each replay it saves
+		static void AddToIndex(const std::string &indexFilePath, int generation, int stage, unsigned int ticks, const std::string &replayFilePath);
+		// What AddToIndex writes, for appending through a BackgroundWriter
+		static std::string GetIndexHeader() { return "generation,stage,ticks,file\n"; }
+		static std::string GetIndexLine(int generation, int stage, unsigned int ticks, const std::string &replayFilePath);
+		// Every file the index names, including the ones Open skips over for a later save
+		static std::vector<std::string> ListFiles(const std::string &indexFilePath);
+
+		unsigned int GetCount();
+		int GetGeneration(unsigned int entry);
+		// The entry for generation, or the nearest one before it
+		unsigned int Find(int generation);
+
+		// Loads entry now unless it's cached or already being loaded, nullptr if it can't be loaded
+		std::shared_ptr<const ReplayRecording> Get(unsigned int entry);
+		// Starts loading the entries around entry in the background, dropping any older requests
+		void Prefetch(unsigned int entry);
+
+		// The generation a replay's birds came from, with their scores once it finished. Null if the history doesn't have it
+		std::shared_ptr<const Generation> RebuildGeneration(int generation);
+
+	private:
+		// The last stage of each generation, which is its best birds flying the longest
+		struct Entry
+		{
+			int generation;
+			int stage;
+			std::string filePath;
+			// Its line in the index, which tells a file saved again apart from the copy already cached
+			unsigned int line;
+		};
+
+		// Keyed by what was loaded rather than the generation, as a generation
+		// still being raced moves on to a later stage's file
+		struct CachedRecording
+		{
+			std::string filePath;
+			unsigned int line;
+			std::shared_ptr<const ReplayRecording> recording;
+			unsigned long long lastUsed;
+		};
+
+		std::mutex _mutex;
+		std::vector<Entry> _entries;
+		GenomeHistory _history;
+
+		std::vector<CachedRecording> _cache;
+		unsigned long long _uses;
+
+		std::deque<unsigned int> _prefetchQueue;
+		// File the prefetch thread is loading, empty if none
+		std::string _loading;
+		std::condition_variable _wake;
+		std::condition_variable _loaded;
+
+		bool _running;
+		std::thread _thread;
+
+		// These expect _mutex to be held
+		// A recording that failed to load is cached as nullptr, so it isn't tried again and again
+		bool FindCached(const Entry &entry, std::shared_ptr<const ReplayRecording> &recording);
+		void AddToCache(const Entry &entry, std::shared_ptr<const ReplayRecording> recording);
+
+		void PrefetchLoop();
+		static std::shared_ptr<const ReplayRecording> Load(const std::string &filePath);
+	};
+}
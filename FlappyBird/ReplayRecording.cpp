@@ -0,0 +1,212 @@
+#include "ReplayRecording.hpp"
+#include "DEFINITIONS.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+
+namespace Sonar
+{
+	namespace
+	{
+		const unsigned int REPLAY_MAGIC = 0x50524246; // "FBRP"
+		const unsigned int REPLAY_VERSION = 1;
+	}
+
+	void ReplayRecording::Begin(unsigned int courseSeed, unsigned int courseLength, int generation, int stage, const std::vector<int> &birdIds, unsigned int tickLimit, int scoreLimit)
+	{
+		_courseSeed = courseSeed;
+		_courseLength = courseLength;
+		_generation = generation;
+		_stage = stage;
+		_birdIds = birdIds;
+		_tickLimit = tickLimit;
+		_scoreLimit = scoreLimit;
+		_tickCount = 0;
+
+		_decisions.clear();
+		_decisionCount = 0;
+		_keyframes.clear();
+		_keyframeData.clear();
+	}
+
+	void ReplayRecording::Reserve(unsigned int ticks, unsigned int keyframeBytes)
+	{
+		unsigned int keyframes = ticks / REPLAY_KEYFRAME_TICKS + 1;
+
+		_decisions.reserve(((size_t)ticks * _birdIds.size() + 7) / 8);
+		_keyframes.reserve(keyframes);
+		_keyframeData.reserve((size_t)keyframes * keyframeBytes);
+	}
+
+	void ReplayRecording::AppendDecision(bool flap)
+	{
+		if (_decisionCount % 8 == 0)
+			_decisions.push_back(0);
+
+		if (flap)
+			_decisions.back() |= (unsigned char)(1 << (_decisionCount % 8));
+
+		_decisionCount++;
+	}
+
+	bool ReplayRecording::GetDecision(unsigned long long index) const
+	{
+		if (index >= _decisionCount)
+			return false;
+
+		return (_decisions[(size_t)(index / 8)] >> (index % 8)) & 1;
+	}
+
+	StateWriter ReplayRecording::BeginKeyframe(unsigned int tick)
+	{
+		_keyframes.push_back(Keyframe{ tick, _decisionCount, (unsigned int)_keyframeData.size(), 0 });
+
+		return StateWriter(_keyframeData);
+	}
+
+	void ReplayRecording::EndKeyframe()
+	{
+		Keyframe &keyframe = _keyframes.back();
+		keyframe.size = (unsigned int)_keyframeData.size() - keyframe.offset;
+	}
+
+	const ReplayRecording::Keyframe *ReplayRecording::FindKeyframe(unsigned int tick) const
+	{
+		// Keyframes are in tick order, so find the first one after tick and step back
+		std::vector<Keyframe>::const_iterator after = std::upper_bound(_keyframes.begin(), _keyframes.end(), tick,
+			[](unsigned int tick, const Keyframe &keyframe) { return tick < keyframe.tick; });
+
+		if (after == _keyframes.begin())
+			return nullptr;
+
+		return &*(after - 1);
+	}
+
+	StateReader ReplayRecording::ReadKeyframe(const Keyframe &keyframe) const
+	{
+		return StateReader(_keyframeData.data() + keyframe.offset, keyframe.size);
+	}
+
+	void ReplayRecording::Serialise(std::vector<char> &buffer) const
+	{
+		buffer.clear();
+		buffer.reserve(256 + _birdIds.size() * sizeof(int) + _decisions.size() + _keyframes.size() * sizeof(Keyframe) + _keyframeData.size());
+		StateWriter out(buffer);
+
+		out.Write(REPLAY_MAGIC);
+		out.Write(REPLAY_VERSION);
+		out.Write(_courseSeed);
+		out.Write(_courseLength);
+		out.Write(_generation);
+		out.Write(_stage);
+		out.Write(_tickLimit);
+		out.Write(_scoreLimit);
+		out.Write(_step);
+		out.Write(_tickCount);
+
+		out.Write((unsigned int)_birdIds.size());
+		for (int id : _birdIds)
+			out.Write(id);
+
+		out.Write(_decisionCount);
+		buffer.insert(buffer.end(), _decisions.begin(), _decisions.end());
+
+		out.Write((unsigned int)_keyframes.size());
+		for (const Keyframe &keyframe : _keyframes)
+			out.Write(keyframe);
+
+		out.Write((unsigned int)_keyframeData.size());
+		buffer.insert(buffer.end(), _keyframeData.begin(), _keyframeData.end());
+	}
+
+	bool ReplayRecording::Save(const std::string &fileName) const
+	{
+		std::vector<char> buffer;
+		Serialise(buffer);
+
+		std::ofstream o(fileName, std::ios::binary);
+		o.write(buffer.data(), buffer.size());
+
+		if (!o.good())
+		{
+			std::cout << "Error Saving Replay " << fileName << std::endl;
+			return false;
+		}
+
+		return true;
+	}
+
+	bool ReplayRecording::Load(const std::string &fileName)
+	{
+		std::ifstream f(fileName, std::ios::binary);
+		if (!f.good())
+		{
+			std::cout << "Error Opening Replay " << fileName << std::endl;
+			return false;
+		}
+
+		std::vector<char> buffer((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+		StateReader in(buffer.data(), buffer.size());
+
+		if (in.Read<unsigned int>() != REPLAY_MAGIC || in.Read<unsigned int>() != REPLAY_VERSION)
+		{
+			std::cout << "Error Loading Replay " << fileName << ", it isn't a replay this version can read" << std::endl;
+			return false;
+		}
+
+		_courseSeed = in.Read<unsigned int>();
+		_courseLength = in.Read<unsigned int>();
+		_generation = in.Read<int>();
+		_stage = in.Read<int>();
+		_tickLimit = in.Read<unsigned int>();
+		_scoreLimit = in.Read<int>();
+		_step = in.Read<float>();
+		_tickCount = in.Read<unsigned int>();
+
+		unsigned int birdCount = in.Read<unsigned int>();
+		_birdIds.clear();
+		for (unsigned int i = 0; i < birdCount && in.IsValid(); i++)
+			_birdIds.push_back(in.Read<int>());
+
+		// Every size is checked against what's left in 64 bits before it's cast or allocated,
+		// so a damaged file can't ask for a huge buffer or wrap round to a small one
+		auto fits = [&in](unsigned long long bytes) { return in.IsValid() && bytes <= (unsigned long long)in.GetRemaining(); };
+
+		_decisionCount = in.Read<unsigned long long>();
+		unsigned long long decisionBytes = _decisionCount / 8 + (_decisionCount % 8 != 0 ? 1 : 0);
+		bool valid = fits(decisionBytes);
+		_decisions.resize(valid ? (size_t)decisionBytes : 0);
+		in.ReadBytes(_decisions.data(), _decisions.size());
+
+		unsigned int keyframeCount = in.Read<unsigned int>();
+		valid = valid && fits((unsigned long long)keyframeCount * sizeof(Keyframe));
+		_keyframes.resize(valid ? keyframeCount : 0);
+		in.ReadBytes(_keyframes.data(), _keyframes.size() * sizeof(Keyframe));
+
+		unsigned int keyframeBytes = in.Read<unsigned int>();
+		valid = valid && fits(keyframeBytes);
+		_keyframeData.resize(valid ? keyframeBytes : 0);
+		in.ReadBytes(_keyframeData.data(), _keyframeData.size());
+
+		if (!valid || !in.IsValid())
+		{
+			std::cout << "Error Loading Replay " << fileName << ", it ends early" << std::endl;
+			return false;
+		}
+
+		// Playback trusts these, Seek reads keyframes straight out of the buffer and the course divides by its length
+		for (const Keyframe &keyframe : _keyframes)
+			if ((unsigned long long)keyframe.offset + keyframe.size > _keyframeData.size() || keyframe.decision > _decisionCount)
+				valid = false;
+
+		if (!valid || _courseLength == 0)
+		{
+			std::cout << "Error Loading Replay " << fileName << ", it's damaged" << std::endl;
+			return false;
+		}
+
+		return true;
+	}
+}
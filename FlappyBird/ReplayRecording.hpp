@@ -0,0 +1,81 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "StateStream.hpp"
+
+namespace Sonar
+{
+	// One episode as the course it flew plus every decision made, one bit per
+	// living bird per tick, in the order the birds were asked. Dead birds cost
+	// nothing, so a whole episode averages under a bit per bird per tick.
+	// The simulation is deterministic given those, so playing it back needs no
+	// networks at all. Every REPLAY_KEYFRAME_TICKS the whole world is kept as
+	// well, so playback can jump anywhere by restoring the keyframe before it
+	// and simulating at most that many ticks on from there.
+	class ReplayRecording
+	{
+	public:
+		struct Keyframe
+		{
+			unsigned int tick;
+			// Index of the first decision made on this tick
+			unsigned long long decision;
+			unsigned int offset;
+			unsigned int size;
+		};
+
+		void Begin(unsigned int courseSeed, unsigned int courseLength, int generation, int stage, const std::vector<int> &birdIds, unsigned int tickLimit, int scoreLimit);
+		// Room for an episode of ticks, so recording it never allocates
+		void Reserve(unsigned int ticks, unsigned int keyframeBytes);
+
+		void AppendDecision(bool flap);
+		bool GetDecision(unsigned long long index) const;
+		unsigned long long GetDecisionCount() const { return _decisionCount; }
+
+		// Write the world into the returned writer, then call EndKeyframe
+		StateWriter BeginKeyframe(unsigned int tick);
+		void EndKeyframe();
+		// The last keyframe at or before tick, nullptr if there are none
+		const Keyframe *FindKeyframe(unsigned int tick) const;
+		// Where playback starts, later than tick 0 if training resumed the episode from a checkpoint
+		const Keyframe *GetFirstKeyframe() const { return _keyframes.empty() ? nullptr : &_keyframes.front(); }
+		StateReader ReadKeyframe(const Keyframe &keyframe) const;
+
+		void SetStep(float step) { _step = step; }
+		void SetTickCount(unsigned int ticks) { _tickCount = ticks; }
+
+		// Everything Save writes, for saving elsewhere
+		void Serialise(std::vector<char> &buffer) const;
+		bool Save(const std::string &fileName) const;
+		bool Load(const std::string &fileName);
+
+		unsigned int GetCourseSeed() const { return _courseSeed; }
+		unsigned int GetCourseLength() const { return _courseLength; }
+		int GetGeneration() const { return _generation; }
+		int GetStage() const { return _stage; }
+		const std::vector<int> &GetBirdIds() const { return _birdIds; }
+		unsigned int GetTickLimit() const { return _tickLimit; }
+		int GetScoreLimit() const { return _scoreLimit; }
+		float GetStep() const { return _step; }
+		unsigned int GetTickCount() const { return _tickCount; }
+
+	private:
+		unsigned int _courseSeed = 0;
+		unsigned int _courseLength = 0;
+		int _generation = 0;
+		int _stage = 0;
+		std::vector<int> _birdIds;
+		unsigned int _tickLimit = 0;
+		int _scoreLimit = 0;
+		float _step = 0;
+		unsigned int _tickCount = 0;
+
+		std::vector<unsigned char> _decisions;
+		unsigned long long _decisionCount = 0;
+
+		std::vector<Keyframe> _keyframes;
+		std::vector<char> _keyframeData;
+	};
+}
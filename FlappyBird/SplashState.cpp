@@ -21,19 +21,6 @@ namespace Sonar
 		_background.setTexture(this->_data->assets.GetTexture("Splash State Background"));
 	}
 
-	void SplashState::HandleInput()
-	{
-		sf::Event event;
-
-		while (this->_data->window.pollEvent(event))
-		{
-			if (sf::Event::Closed == event.type)
-			{
-				this->_data->window.close();
-			}
-		}
-	}
-
 	void SplashState::Update(float dt)
 	{
 		if (this->_clock.getElapsedTime().asSeconds() > SPLASH_STATE_SHOW_TIME)
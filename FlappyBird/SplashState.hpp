@@ -14,7 +14,7 @@ namespace Sonar
 		void Init();
 		void CleanUp() {}
 
-		void HandleInput();
+		void HandleInput() {}
 		void Update(float dt);
 		void Draw(float dt);
 
@@ -0,0 +1,49 @@
+#include "SpriteBatch.hpp"
+
+namespace Sonar
+{
+	SpriteBatch::SpriteBatch(const TextureAtlas &atlas) : _atlas(atlas), _vertices(sf::Quads)
+	{
+	}
+
+	void SpriteBatch::Clear()
+	{
+		// Keeps the vertex storage, so a layer stops allocating once it has grown to size
+		_vertices.clear();
+	}
+
+	void SpriteBatch::Add(const sf::Sprite &sprite)
+	{
+		// Fully transparent sprites, such as the invisible pipes, would draw nothing anyway
+		if (sprite.getColor().a == 0)
+			return;
+
+		sf::Vector2f position;
+		if (!_atlas.GetRegion(sprite.getTexture(), position))
+			return;
+
+		const sf::IntRect &rect = sprite.getTextureRect();
+		const sf::Transform &transform = sprite.getTransform();
+
+		float width = (float)rect.width;
+		float height = (float)rect.height;
+
+		float left = position.x + rect.left;
+		float top = position.y + rect.top;
+
+		sf::Color color = sprite.getColor();
+
+		_vertices.append(sf::Vertex(transform.transformPoint(0, 0), color, sf::Vector2f(left, top)));
+		_vertices.append(sf::Vertex(transform.transformPoint(0, height), color, sf::Vector2f(left, top + height)));
+		_vertices.append(sf::Vertex(transform.transformPoint(width, height), color, sf::Vector2f(left + width, top + height)));
+		_vertices.append(sf::Vertex(transform.transformPoint(width, 0), color, sf::Vector2f(left + width, top)));
+	}
+
+	void SpriteBatch::Draw(sf::RenderTarget &target)
+	{
+		if (_vertices.getVertexCount() == 0)
+			return;
+
+		target.draw(_vertices, &_atlas.GetTexture());
+	}
+}
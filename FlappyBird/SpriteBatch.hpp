@@ -0,0 +1,24 @@
+#pragma once
+
+#include <SFML/Graphics.hpp>
+
+#include "TextureAtlas.hpp"
+
+namespace Sonar
+{
+	// One layer of sprites that all sample from the same atlas, drawn with a single call
+	class SpriteBatch
+	{
+	public:
+		SpriteBatch(const TextureAtlas &atlas);
+
+		void Clear();
+		void Add(const sf::Sprite &sprite);
+		void Draw(sf::RenderTarget &target);
+
+	private:
+		const TextureAtlas &_atlas;
+
+		sf::VertexArray _vertices;
+	};
+}
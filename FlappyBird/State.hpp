@@ -1,13 +1,21 @@
 #pragma once
 
+#include <SFML/Window/Event.hpp>
+
 namespace Sonar
 {
 	class State
 	{
 	public:
+		// Held and deleted as a State by the machine
+		virtual ~State() { }
+
 		virtual void Init() = 0;
 		virtual void CleanUp() = 0;
 
+		// Window events, polled once per rendered frame
+		virtual void HandleEvent(const sf::Event &) { }
+		// Run once per simulation step
 		virtual void HandleInput() = 0;
 		virtual void Update(float dt) = 0;
 		virtual void Draw(float dt) = 0;
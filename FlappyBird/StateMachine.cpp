@@ -1,4 +1,5 @@
 #include "StateMachine.hpp"
+#include "Profiler.hpp"
 
 namespace Sonar
 {
@@ -17,6 +18,8 @@ namespace Sonar
 
 	void StateMachine::ProcessStateChanges()
 	{
+		PROFILE_SCOPE("ProcessStateChanges");
+
 		if (this->_isRemoving && !this->_states.empty())
 		{
 			this->_states.pop();
@@ -50,6 +53,20 @@ namespace Sonar
 		}
 	}
 
+	void StateMachine::Clear()
+	{
+		while (!this->_states.empty())
+		{
+			this->_states.top()->CleanUp();
+			this->_states.pop();
+		}
+
+		// Never started, so there's nothing of it to clean up
+		this->_newState.reset();
+		this->_isAdding = false;
+		this->_isRemoving = false;
+	}
+
 	StateRef &StateMachine::GetActiveState()
 	{
 		return this->_states.top();
@@ -19,14 +19,18 @@ namespace Sonar
 		void RemoveState();
 		// Run at start of each loop in Game.cpp
 		void ProcessStateChanges();
+		// Cleans up every state, newest first, for shutting down
+		void Clear();
 
 		StateRef &GetActiveState();
 
+		bool HasPendingChanges() const { return _isAdding || _isRemoving; }
+
 	private:
 		std::stack<StateRef> _states;
 		StateRef _newState;
 
-		bool _isRemoving;
-		bool _isAdding, _isReplacing;
+		bool _isRemoving = false;
+		bool _isAdding = false, _isReplacing = false;
 	};
 }
\ No newline at end of file
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstring>
+#include <vector>
+
+namespace Sonar
+{
+	// Appends plain values to a byte buffer, for replays and checkpoints. Writing into reserved space never allocates
+	class StateWriter
+	{
+	public:
+		StateWriter(std::vector<char> &out) : _out(out) { }
+
+		template <typename T>
+		void Write(const T &value)
+		{
+			const char *bytes = (const char*)&value;
+			_out.insert(_out.end(), bytes, bytes + sizeof(T));
+		}
+
+	private:
+		std::vector<char> &_out;
+	};
+
+	// Reads back what a StateWriter wrote. Reading past the end gives zeroes and makes it invalid
+	class StateReader
+	{
+	public:
+		StateReader(const char *data, size_t size) : _data(data), _size(size), _position(0) { }
+
+		template <typename T>
+		T Read()
+		{
+			T value{};
+			if (_position + sizeof(T) <= _size)
+				std::memcpy(&value, _data + _position, sizeof(T));
+			_position += sizeof(T);
+			return value;
+		}
+
+		void ReadBytes(void *out, size_t count)
+		{
+			if (count <= GetRemaining())
+				std::memcpy(out, _data + _position, count);
+			_position += count;
+		}
+
+		void Skip(size_t count) { _position += count; }
+
+		size_t GetRemaining() const { return _position < _size ? _size - _position : 0; }
+		bool IsValid() const { return _position <= _size; }
+
+	private:
+		const char *_data;
+		size_t _size;
+		size_t _position;
+	};
+}
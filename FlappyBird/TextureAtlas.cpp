@@ -0,0 +1,78 @@
+#include "TextureAtlas.hpp"
+#include "DEFINITIONS.hpp"
+#include "AllocationCounter.hpp"
+
+#include <algorithm>
+#include <iostream>
+
+namespace Sonar
+{
+	void TextureAtlas::Build(AssetManager &assets, const std::vector<std::string> &textureNames)
+	{
+		MEMORY_TAG(Assets);
+
+		std::vector<const sf::Texture*> sources;
+		for (const std::string &name : textureNames)
+			sources.push_back(&assets.GetTexture(name));
+
+		// Shelf packing, tallest first so each row wastes as little height as possible
+		std::vector<const sf::Texture*> sorted = sources;
+		std::sort(sorted.begin(), sorted.end(), [](const sf::Texture *a, const sf::Texture *b)
+			{
+				return a->getSize().y > b->getSize().y;
+			});
+
+		unsigned int x = 0, y = 0, rowHeight = 0, width = 0;
+
+		_regions.clear();
+		for (const sf::Texture *source : sorted)
+		{
+			sf::Vector2u size = source->getSize();
+
+			if (x > 0 && x + size.x > ATLAS_WIDTH)
+			{
+				x = 0;
+				y += rowHeight + ATLAS_PADDING;
+				rowHeight = 0;
+			}
+
+			Region region;
+			region.source = source;
+			region.position = sf::Vector2f((float)x, (float)y);
+			_regions.push_back(region);
+
+			x += size.x + ATLAS_PADDING;
+			rowHeight = std::max(rowHeight, size.y);
+			width = std::max(width, x);
+		}
+
+		sf::Image image;
+		image.create(width, y + rowHeight, sf::Color::Transparent);
+
+		for (const Region &region : _regions)
+			image.copy(region.source->copyToImage(), (unsigned int)region.position.x, (unsigned int)region.position.y);
+
+		if (!_texture.loadFromImage(image))
+		{
+			std::cout << "Error Building Texture Atlas" << std::endl;
+			return;
+		}
+
+		_built = true;
+	}
+
+	bool TextureAtlas::GetRegion(const sf::Texture *source, sf::Vector2f &position) const
+	{
+		// Only a handful of textures are packed, so a linear search beats a map
+		for (const Region &region : _regions)
+		{
+			if (region.source == source)
+			{
+				position = region.position;
+				return true;
+			}
+		}
+
+		return false;
+	}
+}
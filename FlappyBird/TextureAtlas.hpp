@@ -0,0 +1,38 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <SFML/Graphics.hpp>
+
+#include "AssetManager.hpp"
+
+namespace Sonar
+{
+	// Packs several loaded textures into one, so sprites using any of them can
+	// be drawn together in a single draw call
+	class TextureAtlas
+	{
+	public:
+		TextureAtlas() : _built(false) { }
+
+		void Build(AssetManager &assets, const std::vector<std::string> &textureNames);
+		bool IsBuilt() const { return _built; }
+
+		const sf::Texture &GetTexture() const { return _texture; }
+
+		// Where the source texture was packed, false if it isn't in the atlas
+		bool GetRegion(const sf::Texture *source, sf::Vector2f &position) const;
+
+	private:
+		struct Region
+		{
+			const sf::Texture *source;
+			sf::Vector2f position;
+		};
+
+		sf::Texture _texture;
+		std::vector<Region> _regions;
+
+		bool _built;
+	};
+}
@@ -0,0 +1,155 @@
+#include "ThroughputBenchmark.hpp"
+#include "GameState.hpp"
+#include "AIController.h"
+#include "ProcessStats.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+
+namespace Sonar
+{
+	ThroughputBenchmark::ThroughputBenchmark() : _data(std::make_shared<GameData>())
+	{
+	}
+
+	bool ThroughputBenchmark::Run()
+	{
+		srand(THROUGHPUT_SEED);
+
+		// Start from nothing every time, so every run trains the same generations
+		AIController::SetFilePrefix(THROUGHPUT_FILE_PREFIX);
+		AIController::SetBreedingSeed(THROUGHPUT_SEED);
+		AIController::RemoveFiles(THROUGHPUT_FILE_PREFIX);
+
+		_data->assets.OpenArchive(ASSET_ARCHIVE_FILEPATH);
+
+		// Nothing is drawn, but textures need a context and everything is laid out against the window size
+		_data->window.create(sf::VideoMode(SCREEN_WIDTH, SCREEN_HEIGHT), "Throughput Benchmark", sf::Style::None);
+		_data->window.setVisible(false);
+
+		// Saving as training does, so its cost on the simulation thread is counted
+		_data->writer = std::make_shared<BackgroundWriter>();
+		json result = Train();
+		_data->writer.reset();
+
+		AIController::RemoveFiles(THROUGHPUT_FILE_PREFIX);
+		_data->window.close();
+
+		std::ofstream o(THROUGHPUT_FILEPATH);
+		o << std::setw(4) << result << std::endl;
+		o.close();
+
+		std::cout << "Trained " << THROUGHPUT_GENERATIONS << " generations in " << result["wall_seconds"] << "s, "
+			<< result["ticks_per_second"] << " ticks/s, " << result["generation_seconds"] << "s per generation, "
+			<< result["turnover_seconds"] << "s per turnover, " << result["peak_rss_bytes"] << " bytes peak" << std::endl;
+
+		std::ifstream f(THROUGHPUT_BASELINE_FILEPATH);
+		if (!f.good())
+		{
+			std::ofstream b(THROUGHPUT_BASELINE_FILEPATH);
+			b << std::setw(4) << result << std::endl;
+
+			std::cout << "No baseline, saved this run as " << THROUGHPUT_BASELINE_FILEPATH << std::endl;
+			return true;
+		}
+
+		return Compare(result, json::parse(f));
+	}
+
+	json ThroughputBenchmark::Train()
+	{
+		const float dt = 1.0f / 60.0f;
+
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+		unsigned long long ticks = 0;
+		unsigned int episodes = 0;
+		double turnoverSeconds = 0;
+		int generation = 0;
+
+		_data->machine.AddState(StateRef(new GameState(_data)));
+		_data->machine.ProcessStateChanges();
+
+		while (generation < THROUGHPUT_GENERATIONS)
+		{
+			// The same as a step of the game, minus everything to do with the window
+			_data->machine.GetActiveState()->HandleInput();
+			_data->machine.GetActiveState()->Update(dt);
+			ticks++;
+
+			if (!_data->machine.HasPendingChanges())
+				continue;
+
+			// Saving, breeding and loading the next generation, all of it dead time for training
+			std::chrono::steady_clock::time_point turnoverStart = std::chrono::steady_clock::now();
+			_data->machine.ProcessStateChanges();
+			turnoverSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - turnoverStart).count();
+
+			episodes++;
+			generation = static_cast<GameState*>(_data->machine.GetActiveState().get())->GetAIController()->GetCurrentGeneration();
+		}
+
+		double wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		_data->machine.GetActiveState()->CleanUp();
+
+		json result;
+		result["seed"] = THROUGHPUT_SEED;
+		result["generations"] = THROUGHPUT_GENERATIONS;
+		result["bird_count"] = BIRD_COUNT;
+		result["episodes"] = episodes;
+		result["ticks"] = ticks;
+		result["wall_seconds"] = wallSeconds;
+		result["ticks_per_second"] = ticks / wallSeconds;
+		result["generation_seconds"] = wallSeconds / THROUGHPUT_GENERATIONS;
+		result["generations_per_hour"] = THROUGHPUT_GENERATIONS * 3600.0 / wallSeconds;
+		result["turnover_seconds"] = turnoverSeconds / episodes;
+		result["peak_rss_bytes"] = ProcessStats::GetPeakResidentBytes();
+		// Only the first generation should load anything, the rest are hits
+		result["asset_loads"] = _data->assets.GetStats().loads;
+		result["asset_hits"] = _data->assets.GetStats().hits;
+
+		return result;
+	}
+
+	bool ThroughputBenchmark::Compare(const json &result, const json &baseline)
+	{
+		// Timings only mean something if both runs trained exactly the same birds
+		if (result["ticks"] != baseline.value("ticks", 0ULL) || result["bird_count"] != baseline.value("bird_count", 0))
+		{
+			std::cout << "Error Baseline Trained Something Else (" << baseline.value("ticks", 0ULL) << " ticks), Delete "
+				<< THROUGHPUT_BASELINE_FILEPATH << " To Record A New One" << std::endl;
+			return false;
+		}
+
+		bool regressed = false;
+		regressed |= IsRegression("ticks_per_second", result["ticks_per_second"], baseline["ticks_per_second"], true);
+		regressed |= IsRegression("generation_seconds", result["generation_seconds"], baseline["generation_seconds"], false);
+		regressed |= IsRegression("turnover_seconds", result["turnover_seconds"], baseline["turnover_seconds"], false);
+		regressed |= IsRegression("peak_rss_bytes", result["peak_rss_bytes"], baseline["peak_rss_bytes"], false);
+
+		if (!regressed)
+			std::cout << "Within " << THROUGHPUT_TOLERANCE * 100 << "% of the baseline" << std::endl;
+
+		return !regressed;
+	}
+
+	bool ThroughputBenchmark::IsRegression(const std::string &name, double measured, double expected, bool higherIsBetter)
+	{
+		double change = expected > 0 ? (measured - expected) / expected : 0;
+		if (higherIsBetter)
+			change = -change;
+
+		if (change <= THROUGHPUT_TOLERANCE)
+			return false;
+
+		std::cout << "Regression " << name << " " << measured << " against " << expected << " in the baseline ("
+			<< std::fixed << std::setprecision(1) << change * 100 << "% worse)" << std::endl;
+
+		return true;
+	}
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <string>
+#include <nlohmann/json.hpp>
+
+#include "Game.hpp"
+
+using json = nlohmann::json;
+
+namespace Sonar
+{
+	// Trains a fixed number of generations from a fixed seed as fast as the
+	// simulation allows, with nothing drawn, to see how many generations an
+	// hour a configuration can sustain. Each run is compared against a stored
+	// baseline, and fails if it is worse by more than THROUGHPUT_TOLERANCE.
+	class ThroughputBenchmark
+	{
+	public:
+		ThroughputBenchmark();
+
+		bool Run();
+
+	private:
+		GameDataRef _data;
+
+		json Train();
+		bool Compare(const json &result, const json &baseline);
+		// Whether measured is worse than expected by more than the tolerance
+		bool IsRegression(const std::string &name, double measured, double expected, bool higherIsBetter);
+	};
+}
@@ -0,0 +1,198 @@
+#include "TraceRecorder.hpp"
+#include "DEFINITIONS.hpp"
+#include "AllocationCounter.hpp"
+#include "Metrics.hpp"
+
+#include <iostream>
+
+namespace Sonar
+{
+	std::atomic<bool> TraceRecorder::s_recording(false);
+	std::chrono::steady_clock::time_point TraceRecorder::s_origin;
+
+	std::mutex TraceRecorder::s_mutex;
+	std::vector<std::unique_ptr<TraceRecorder::ThreadBuffer>> TraceRecorder::s_buffers;
+
+	std::ofstream TraceRecorder::s_file;
+	bool TraceRecorder::s_firstEvent = true;
+
+	std::thread TraceRecorder::s_flushThread;
+	std::condition_variable TraceRecorder::s_flushWake;
+
+	bool TraceRecorder::Start(const std::string &fileName)
+	{
+		std::lock_guard<std::mutex> lock(s_mutex);
+
+		if (s_recording)
+			return true;
+
+		s_file.open(fileName);
+		if (!s_file.good())
+		{
+			std::cout << "Error Opening Trace " << fileName << std::endl;
+			return false;
+		}
+
+		s_file << "[\n";
+		s_firstEvent = true;
+		s_origin = std::chrono::steady_clock::now();
+
+		s_recording = true;
+		s_flushThread = std::thread(FlushLoop);
+
+		return true;
+	}
+
+	void TraceRecorder::Stop()
+	{
+		{
+			std::lock_guard<std::mutex> lock(s_mutex);
+
+			if (!s_recording)
+				return;
+
+			s_recording = false;
+		}
+
+		s_flushWake.notify_all();
+		s_flushThread.join();
+
+		std::lock_guard<std::mutex> lock(s_mutex);
+
+		Flush();
+
+		s_file << "\n]\n";
+		s_file.close();
+	}
+
+	void TraceRecorder::SetThreadName(const char *name)
+	{
+		ThreadBuffer &buffer = GetThreadBuffer();
+
+		std::lock_guard<std::mutex> lock(buffer.mutex);
+		buffer.threadName = name;
+		buffer.nameWritten = false;
+	}
+
+	void TraceRecorder::Complete(const char *name, std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end, const char *argName, long long argValue)
+	{
+		if (!s_recording)
+			return;
+
+		ThreadBuffer &buffer = GetThreadBuffer();
+		long long startMicroseconds = ToMicroseconds(start);
+
+		std::lock_guard<std::mutex> lock(buffer.mutex);
+
+		if (buffer.events.size() >= TRACE_BUFFER_EVENTS)
+		{
+			buffer.dropped++;
+			return;
+		}
+
+		buffer.events.push_back(Event{ name, startMicroseconds, ToMicroseconds(end) - startMicroseconds, argName, argValue });
+		METRIC_ADD(TraceQueueDepth, 1);
+	}
+
+	TraceRecorder::ThreadBuffer &TraceRecorder::GetThreadBuffer()
+	{
+		// Owned by the recorder rather than the thread, so nothing is lost when a thread exits before a flush
+		thread_local ThreadBuffer *buffer = nullptr;
+
+		if (buffer == nullptr)
+		{
+			MEMORY_TAG(Logging);
+
+			std::lock_guard<std::mutex> lock(s_mutex);
+
+			s_buffers.push_back(std::unique_ptr<ThreadBuffer>(new ThreadBuffer()));
+			buffer = s_buffers.back().get();
+
+			buffer->threadId = (unsigned int)s_buffers.size();
+			buffer->threadName = nullptr;
+			buffer->nameWritten = false;
+			buffer->events.reserve(TRACE_BUFFER_EVENTS);
+			buffer->flushing.reserve(TRACE_BUFFER_EVENTS);
+			buffer->dropped = 0;
+		}
+
+		return *buffer;
+	}
+
+	long long TraceRecorder::ToMicroseconds(std::chrono::steady_clock::time_point time)
+	{
+		return std::chrono::duration_cast<std::chrono::microseconds>(time - s_origin).count();
+	}
+
+	void TraceRecorder::FlushLoop()
+	{
+		std::unique_lock<std::mutex> lock(s_mutex);
+
+		while (s_recording)
+		{
+			s_flushWake.wait_for(lock, std::chrono::duration<float>(TRACE_FLUSH_INTERVAL));
+			Flush();
+		}
+	}
+
+	void TraceRecorder::Flush()
+	{
+		// Called with s_mutex held, each buffer is only held long enough to swap it out
+		for (std::unique_ptr<ThreadBuffer> &buffer : s_buffers)
+		{
+			const char *threadName;
+			bool writeName;
+			unsigned long long dropped;
+
+			{
+				std::lock_guard<std::mutex> lock(buffer->mutex);
+
+				buffer->flushing.clear();
+				buffer->flushing.swap(buffer->events);
+				METRIC_ADD(TraceQueueDepth, -(long long)buffer->flushing.size());
+
+				threadName = buffer->threadName;
+				writeName = threadName != nullptr && !buffer->nameWritten;
+				buffer->nameWritten = buffer->nameWritten || writeName;
+
+				dropped = buffer->dropped;
+				buffer->dropped = 0;
+			}
+
+			if (writeName)
+			{
+				WriteSeparator();
+				s_file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->threadId
+					<< ",\"args\":{\"name\":\"" << threadName << "\"}}";
+			}
+
+			for (const Event &event : buffer->flushing)
+			{
+				WriteSeparator();
+				s_file << "{\"name\":\"" << event.name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->threadId
+					<< ",\"ts\":" << event.start << ",\"dur\":" << event.duration;
+
+				if (event.argName != nullptr)
+					s_file << ",\"args\":{\"" << event.argName << "\":" << event.argValue << "}";
+
+				s_file << "}";
+			}
+
+			if (dropped > 0)
+			{
+				WriteSeparator();
+				s_file << "{\"name\":\"Dropped Events\",\"ph\":\"i\",\"s\":\"t\",\"pid\":1,\"tid\":" << buffer->threadId
+					<< ",\"ts\":" << ToMicroseconds(std::chrono::steady_clock::now()) << ",\"args\":{\"dropped\":" << dropped << "}}";
+			}
+		}
+
+		s_file.flush();
+	}
+
+	void TraceRecorder::WriteSeparator()
+	{
+		if (!s_firstEvent)
+			s_file << ",\n";
+		s_firstEvent = false;
+	}
+}
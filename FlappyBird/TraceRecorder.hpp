@@ -0,0 +1,75 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace Sonar
+{
+	// Writes spans out as Chrome trace events, for chrome://tracing or Perfetto.
+	// Each thread fills its own buffer of TRACE_BUFFER_EVENTS, which a background
+	// thread swaps out and writes every TRACE_FLUSH_INTERVAL. A buffer that fills
+	// up before then drops events rather than growing, and the drops are written
+	// into the trace so a gap can't be mistaken for a stall.
+	class TraceRecorder
+	{
+	public:
+		static bool Start(const std::string &fileName);
+		static void Stop();
+		static bool IsRecording() { return s_recording; }
+
+		// Shown as the calling thread's name in the trace
+		static void SetThreadName(const char *name);
+
+		// name and argName must outlive the recorder, string literals or zone names
+		static void Complete(const char *name, std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end, const char *argName = nullptr, long long argValue = 0);
+
+	private:
+		struct Event
+		{
+			const char *name;
+			long long start;
+			long long duration;
+			const char *argName;
+			long long argValue;
+		};
+
+		struct ThreadBuffer
+		{
+			unsigned int threadId;
+			const char *threadName;
+			bool nameWritten;
+
+			std::mutex mutex;
+			std::vector<Event> events;
+			// Swapped with events to write out, so neither ever reallocates
+			std::vector<Event> flushing;
+			unsigned long long dropped;
+		};
+
+		static std::atomic<bool> s_recording;
+		static std::chrono::steady_clock::time_point s_origin;
+
+		static std::mutex s_mutex;
+		static std::vector<std::unique_ptr<ThreadBuffer>> s_buffers;
+
+		static std::ofstream s_file;
+		static bool s_firstEvent;
+
+		static std::thread s_flushThread;
+		static std::condition_variable s_flushWake;
+
+		static ThreadBuffer &GetThreadBuffer();
+		static long long ToMicroseconds(std::chrono::steady_clock::time_point time);
+
+		static void FlushLoop();
+		static void Flush();
+		static void WriteSeparator();
+	};
+}
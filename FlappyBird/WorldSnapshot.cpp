@@ -0,0 +1,79 @@
+#include "WorldSnapshot.hpp"
+#include "Metrics.hpp"
+
+#include <algorithm>
+#include <utility>
+
+namespace Sonar
+{
+	void WorldSnapshot::Clear()
+	{
+		// Keeps the capacity, so a slot stops allocating once it has seen a busy step
+		pipes.clear();
+		land.clear();
+		livingBirds.clear();
+		fallenBirds.clear();
+	}
+
+	void WorldSnapshot::Capture(std::vector<SpriteSnapshot> &layer, unsigned int id, const sf::Sprite &sprite, unsigned int frame)
+	{
+		layer.push_back(SpriteSnapshot{ id, sprite.getPosition(), sprite.getRotation(), frame });
+	}
+
+	void WorldSnapshot::SortById(std::vector<SpriteSnapshot> &layer)
+	{
+		std::sort(layer.begin(), layer.end(), [](const SpriteSnapshot &a, const SpriteSnapshot &b) { return a.id < b.id; });
+	}
+
+	sf::Sprite SpriteLayer::Build(unsigned int frame, sf::Vector2f position, float rotation) const
+	{
+		sf::Sprite sprite;
+		if (!_frames.empty())
+			sprite.setTexture(*_frames[frame < _frames.size() ? frame : 0], true);
+
+		sprite.setOrigin(_origin);
+		sprite.setPosition(position);
+		sprite.setRotation(rotation);
+
+		return sprite;
+	}
+
+	SnapshotBuffer::SnapshotBuffer() : _write(0), _ready(1), _read(2), _previous(3), _fresh(false)
+	{
+	}
+
+	void SnapshotBuffer::Reserve(unsigned int pipes, unsigned int land, unsigned int birds)
+	{
+		for (WorldSnapshot &slot : _slots)
+		{
+			slot.pipes.reserve(pipes);
+			slot.land.reserve(land);
+			slot.livingBirds.reserve(birds);
+			slot.fallenBirds.reserve(birds);
+		}
+	}
+
+	void SnapshotBuffer::Publish()
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+
+		std::swap(_write, _ready);
+		_fresh = true;
+		METRIC_SET(SnapshotQueueDepth, 1);
+	}
+
+	bool SnapshotBuffer::Consume()
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+
+		if (!_fresh)
+			return false;
+
+		std::swap(_previous, _read);
+		std::swap(_read, _ready);
+		_fresh = false;
+		METRIC_SET(SnapshotQueueDepth, 0);
+
+		return true;
+	}
+}
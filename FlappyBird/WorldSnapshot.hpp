@@ -0,0 +1,91 @@
+#pragma once
+
+#include <mutex>
+#include <vector>
+#include <SFML/Graphics.hpp>
+
+namespace Sonar
+{
+	// Where a sprite was after a step, with an id to find the same sprite in the next snapshot
+	struct SpriteSnapshot
+	{
+		unsigned int id;
+		sf::Vector2f position;
+		float rotation;
+		// Which of its layer's textures it shows
+		unsigned int frame;
+	};
+
+	// Everything the renderer needs from one simulation step. Each layer is kept
+	// in id order, so consecutive snapshots can be matched up in a single pass
+	struct WorldSnapshot
+	{
+		float simulatedTime = 0;
+		float step = 0;
+		float publishedAt = 0;
+
+		int score = 0;
+		bool gameOver = false;
+
+		std::vector<SpriteSnapshot> pipes;
+		std::vector<SpriteSnapshot> land;
+		std::vector<SpriteSnapshot> livingBirds;
+		std::vector<SpriteSnapshot> fallenBirds;
+
+		void Clear();
+		static void Capture(std::vector<SpriteSnapshot> &layer, unsigned int id, const sf::Sprite &sprite, unsigned int frame = 0);
+		// In place, for layers captured out of order
+		static void SortById(std::vector<SpriteSnapshot> &layer);
+	};
+
+	// What a snapshot leaves out of a layer's sprites, kept on the render side to build them again
+	class SpriteLayer
+	{
+	public:
+		SpriteLayer() : _origin(0, 0) { }
+
+		void AddFrame(const sf::Texture &texture) { _frames.push_back(&texture); }
+		void SetOrigin(sf::Vector2f origin) { _origin = origin; }
+
+		sf::Sprite Build(unsigned int frame, sf::Vector2f position, float rotation) const;
+
+	private:
+		std::vector<const sf::Texture*> _frames;
+		sf::Vector2f _origin;
+	};
+
+	// Hands snapshots from the simulation to the renderer without either waiting
+	// on the other. The writer and reader each own a slot, with one more slot
+	// holding the latest published snapshot and one holding the reader's previous
+	// snapshot to interpolate from. Only slot indices are swapped under the lock.
+	class SnapshotBuffer
+	{
+	public:
+		SnapshotBuffer();
+
+		// Slot for the simulation to fill in, then pass on with Publish
+		WorldSnapshot &BeginWrite() { return _slots[_write]; }
+		void Publish();
+
+		// Takes the newest snapshot if there is one, false if nothing has changed
+		bool Consume();
+
+		// Sizes every slot's layers up front, so publishing never allocates
+		void Reserve(unsigned int pipes, unsigned int land, unsigned int birds);
+
+		const WorldSnapshot &GetCurrent() const { return _slots[_read]; }
+		const WorldSnapshot &GetPrevious() const { return _slots[_previous]; }
+
+	private:
+		WorldSnapshot _slots[4];
+
+		int _write;
+		int _ready;
+		int _read;
+		int _previous;
+
+		bool _fresh;
+
+		std::mutex _mutex;
+	};
+}
@@ -1,8 +1,31 @@
 #include "Game.hpp"
 #include "DEFINITIONS.hpp"
+#include "Benchmark.hpp"
+#include "ThroughputBenchmark.hpp"
 
 int main()
 {
+#if PACK_ASSETS
+	// Everything the game loads, by the same path it asks for it with
+	bool packed = Sonar::AssetArchive::Pack(ASSET_ARCHIVE_FILEPATH, {
+		SPLASH_SCENE_BACKGROUND_FILEPATH, MAIN_MENU_BACKGROUND_FILEPATH, GAME_TITLE_FILEPATH, PLAY_BUTTON_FILEPATH,
+		PIPE_UP_FILEPATH, PIPE_DOWN_FILEPATH, LAND_FILEPATH, SCORING_PIPE_FILEPATH,
+		BIRD_FRAME_1_FILEPATH, BIRD_FRAME_2_FILEPATH, BIRD_FRAME_3_FILEPATH, BIRD_FRAME_4_FILEPATH,
+		GAME_OVER_TITLE_FILEPATH, GAME_OVER_BODY_FILEPATH,
+		BRONZE_MEDAL_FILEPATH, SILVER_MEDAL_FILEPATH, GOLD_MEDAL_FILEPATH, PLATINUM_MEDAL_FILEPATH,
+		FLAPPY_FONT_FILEPATH, HIT_SOUND_FILEPATH, POINT_SOUND_FILEPATH, WING_SOUND_FILEPATH });
+
+	return packed ? EXIT_SUCCESS : EXIT_FAILURE;
+#endif
+
+#if BENCHMARK
+	return Sonar::Benchmark().Run() ? EXIT_SUCCESS : EXIT_FAILURE;
+#endif
+
+#if THROUGHPUT_BENCHMARK
+	return Sonar::ThroughputBenchmark().Run() ? EXIT_SUCCESS : EXIT_FAILURE;
+#endif
+
 	srand(time(NULL));
 
 	Sonar::Game(SCREEN_WIDTH, SCREEN_HEIGHT, "Flappy Bird");